@@ -1,4 +1,5 @@
-benchmarks_sources:=generic/mempool_benchmark.c
+benchmarks_sources:=generic/mempool_benchmark.c lval_benchmark.c lenv_benchmark.c \
+	leval_benchmark.c lbuiltin_operator_benchmark.c lfunc_benchmark.c
 benchmark_build_dir:=$(build_dir)
 
 benchmarks:=$(benchmarks_sources:%.c=%)
@@ -20,10 +21,15 @@ $(benchmarks_built): %: %.o $(filter-out $(build_dir)/$(PROGNAME).o,$(objects))
 $(build_dir)/%_benchmark.o: %_benchmark.c $$(@D)/.f
 	@$(CC) $(CFLAGS) $(BENCH_CFLAGS) -c -o $@ $<
 
+# Compare the bignum backends.
+benchmark_gmp:
+	@$(MAKE) --no-print-directory lbuiltin_operator_benchmark GMP=mini
+	@$(MAKE) --no-print-directory lbuiltin_operator_benchmark GMP=system
+
 benchmark_clean:
 	@rm -f $(benchmarks_obj) $(benchmarks_built)
 
 clean:: benchmark_clean
 
 # List of all special targets (always out-of-date).
-.PHONY: clean benchmark $(benchmarks) $(benchmarks_built)
+.PHONY: clean benchmark benchmark_gmp $(benchmarks) $(benchmarks_built)
@@ -6,10 +6,14 @@
 #include <readline/readline.h>
 #include <readline/history.h>
 #include <signal.h>
+#include <string.h>
 
 #include "version.h"
 #include "leval.h"
 #include "lenv.h"
+#include "lparser.h"
+#include "lsym.h"
+#include "lvm.h"
 
 /* Configurable variables */
 static char* prompt = "> ";
@@ -22,6 +26,10 @@ static struct lenv* env = NULL;
 void handler_SIGINT(int sig) {
     (void)sig;
     lenv_free(env);
+    lvm_release();
+    lval_alloc_release();
+    lsym_release();
+    last_release();
     fputc('\n', stdout);
     exit(EXIT_SUCCESS);
 }
@@ -35,7 +43,7 @@ int main(int argc, char** argv) {
 
     /* Command line arguments */
     int c;
-    while ((c = getopt(argc, argv, "p:f:")) != -1) {
+    while ((c = getopt(argc, argv, "p:f:a:e:g:")) != -1) {
         switch (c) {
         case 'p':
             prompt = optarg;
@@ -43,6 +51,39 @@ int main(int argc, char** argv) {
         case 'f':
             filename = optarg;
             break;
+        case 'a':
+            if (strcmp(optarg, "pool") == 0) {
+                lval_set_alloc_mode(LALLOC_POOL);
+            } else if (strcmp(optarg, "malloc") == 0) {
+                lval_set_alloc_mode(LALLOC_MALLOC);
+            } else {
+                fprintf(stderr, "unknown allocator `%s` (malloc or pool)\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'g':
+            if (strcmp(optarg, "trace") == 0) {
+                lval_set_gc_mode(LGC_TRACE);
+            } else if (strcmp(optarg, "refc") == 0) {
+                lval_set_gc_mode(LGC_REFC);
+            } else {
+                fprintf(stderr, "unknown collector `%s` (refc or trace)\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'e':
+            if (strcmp(optarg, "tree") == 0) {
+                leval_set_engine(LEVAL_TREE);
+            } else if (strcmp(optarg, "vm") == 0) {
+                leval_set_engine(LEVAL_VM);
+            } else if (strcmp(optarg, "vm-all") == 0) {
+                leval_set_engine(LEVAL_VM);
+                leval_set_compile_all(true);
+            } else {
+                fprintf(stderr, "unknown engine `%s` (tree, vm or vm-all)\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
         }
     }
 
@@ -62,6 +103,10 @@ int main(int argc, char** argv) {
                 s = EXIT_FAILURE;
             }
             lenv_free(env);
+            lvm_release();
+            lval_alloc_release();
+            lsym_release();
+            last_release();
             fclose(file);
             return s;
         } else {
@@ -98,5 +143,9 @@ int main(int argc, char** argv) {
     }
 
     lenv_free(env);
+    lvm_release();
+    lval_alloc_release();
+    lsym_release();
+    last_release();
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,213 @@
+#include "htable.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** HT_MIN_CAPACITY is the smallest number of slots of a table. */
+#define HT_MIN_CAPACITY 8
+
+struct ht_entry {
+    /** ht_entry.hash is the hash of ht_entry.key. */
+    uint64_t hash;
+    /** ht_entry.key identifies the entry. */
+    const char* key;
+    /** ht_entry.payload is the bound data. NULL for an empty slot. */
+    void* payload;
+};
+
+struct htable {
+    /** htable.size is the number of used slots. */
+    size_t size;
+    /** htable.mask is the number of slots minus one (a power of 2). */
+    size_t mask;
+    /** htable.entries are the slots. */
+    struct ht_entry* entries;
+};
+
+uint64_t ht_hash(const char* key) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const unsigned char* c = (const unsigned char*)key; *c; c++) {
+        hash ^= *c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/** ht_slots returns the number of slots needed to hold size entries.
+ ** The load factor is kept under 1/2 to keep probe sequences short. */
+static size_t ht_slots(size_t size) {
+    size_t slots = HT_MIN_CAPACITY;
+    while (slots < 2 * size) {
+        slots <<= 1;
+    }
+    return slots;
+}
+
+struct htable* ht_alloc(size_t capacity) {
+    struct htable* table = calloc(1, sizeof(struct htable));
+    size_t slots = ht_slots(capacity);
+    table->size = 0;
+    table->mask = slots - 1;
+    table->entries = calloc(slots, sizeof(struct ht_entry));
+    return table;
+}
+
+void ht_free(struct htable* table, ht_pl_destructor destructor) {
+    if (!table) {
+        return;
+    }
+    for (size_t s = 0; s <= table->mask; s++) {
+        if (table->entries[s].payload) {
+            destructor(table->entries[s].payload);
+        }
+    }
+    free(table->entries);
+    free(table);
+}
+
+struct htable* ht_duplicate(const struct htable* src,
+        ht_pl_duplicator copy, ht_pl_serializer serializer) {
+    if (!src) {
+        return NULL;
+    }
+    struct htable* dest = calloc(1, sizeof(struct htable));
+    dest->size = src->size;
+    dest->mask = src->mask;
+    dest->entries = calloc(src->mask + 1, sizeof(struct ht_entry));
+    for (size_t s = 0; s <= src->mask; s++) {
+        if (!src->entries[s].payload) {
+            continue;
+        }
+        void* payload = copy(src->entries[s].payload);
+        dest->entries[s].hash = src->entries[s].hash;
+        dest->entries[s].key = serializer(payload);
+        dest->entries[s].payload = payload;
+    }
+    return dest;
+}
+
+/** ht_find returns the slot of key or the empty slot where it belongs. */
+static struct ht_entry* ht_find(const struct htable* table,
+        const char* key, uint64_t hash) {
+    size_t s = hash & table->mask;
+    while (true) {
+        struct ht_entry* entry = &table->entries[s];
+        if (!entry->payload) {
+            return entry;
+        }
+        if (entry->hash == hash
+                && (entry->key == key || strcmp(entry->key, key) == 0)) {
+            return entry;
+        }
+        s = (s + 1) & table->mask;
+    }
+}
+
+/** ht_grow doubles the number of slots of table. */
+static void ht_grow(struct htable* table) {
+    struct ht_entry* old = table->entries;
+    size_t old_slots = table->mask + 1;
+    table->mask = 2 * old_slots - 1;
+    table->entries = calloc(2 * old_slots, sizeof(struct ht_entry));
+    for (size_t s = 0; s < old_slots; s++) {
+        if (old[s].payload) {
+            *ht_find(table, old[s].key, old[s].hash) = old[s];
+        }
+    }
+    free(old);
+}
+
+bool ht_insert(struct htable* table, const char* key, uint64_t hash,
+        void* payload, ht_pl_destructor destructor, bool* insertion) {
+    if (!table || !key || !payload) {
+        return false;
+    }
+    struct ht_entry* entry = ht_find(table, key, hash);
+    /* Override. */
+    if (entry->payload) {
+        *insertion = false;
+        destructor(entry->payload);
+        entry->key = key;
+        entry->payload = payload;
+        return true;
+    }
+    /* Insert. */
+    *insertion = true;
+    if (2 * (table->size + 1) > table->mask + 1) {
+        ht_grow(table);
+        entry = ht_find(table, key, hash);
+    }
+    entry->hash = hash;
+    entry->key = key;
+    entry->payload = payload;
+    table->size++;
+    return true;
+}
+
+void* ht_remove(struct htable* table, const char* key, uint64_t hash) {
+    if (!table || !key) {
+        return NULL;
+    }
+    struct ht_entry* entry = ht_find(table, key, hash);
+    void* payload = entry->payload;
+    if (!payload) {
+        return NULL;
+    }
+    /* The entries following the hole in its probe sequence are shifted back
+     * into it, unless their home slot is after the hole. */
+    size_t hole = entry - table->entries;
+    size_t s = hole;
+    while (true) {
+        s = (s + 1) & table->mask;
+        struct ht_entry* next = &table->entries[s];
+        if (!next->payload) {
+            break;
+        }
+        size_t home = next->hash & table->mask;
+        if (((s - home) & table->mask) >= ((s - hole) & table->mask)) {
+            table->entries[hole] = *next;
+            hole = s;
+        }
+    }
+    table->entries[hole].hash = 0;
+    table->entries[hole].key = NULL;
+    table->entries[hole].payload = NULL;
+    table->size--;
+    return payload;
+}
+
+void* ht_lookup(const struct htable* table, const char* key, uint64_t hash) {
+    if (!table || !key) {
+        return NULL;
+    }
+    return ht_find(table, key, hash)->payload;
+}
+
+size_t ht_size(const struct htable* table) {
+    if (!table) {
+        return 0;
+    }
+    return table->size;
+}
+
+static int ht_key_cmp(const void* leftv, const void* rightv) {
+    return strcmp(*(const char**)leftv, *(const char**)rightv);
+}
+
+const char** ht_keys(const struct htable* table, size_t* len) {
+    if (ht_size(table) == 0) {
+        return NULL;
+    }
+    *len = table->size;
+    const char** list = calloc(table->size, sizeof(const char*));
+    size_t k = 0;
+    for (size_t s = 0; s <= table->mask; s++) {
+        if (table->entries[s].payload) {
+            list[k++] = table->entries[s].key;
+        }
+    }
+    qsort(list, k, sizeof(const char*), ht_key_cmp);
+    return list;
+}
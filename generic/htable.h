@@ -0,0 +1,48 @@
+#ifndef H_HTABLE_GENERIC_
+#define H_HTABLE_GENERIC_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/** htable is an open addressing hash table (linear probing) keyed by strings.
+ ** Each entry keeps the hash of its key so that probing rarely compares keys.
+ ** Keys are not copied: they must stay valid as long as their entry lives,
+ ** the usual way being to point inside the payload. */
+struct htable;
+
+/** ht_pl_destructor destroys a payload. */
+typedef void (*ht_pl_destructor)(void*);
+/** ht_pl_duplicator duplictes a payload. */
+typedef void* (*ht_pl_duplicator)(const void*);
+/** ht_pl_serializer returns the key of a payload. */
+typedef const char* (*ht_pl_serializer)(const void*);
+
+/** ht_hash returns the hash of key (FNV-1a). */
+uint64_t ht_hash(const char* key);
+
+/** ht_alloc returns a new table able to hold capacity entries without growing. */
+struct htable* ht_alloc(size_t capacity);
+/** ht_free frees table and all its payloads. */
+void ht_free(struct htable* table, ht_pl_destructor destructor);
+/** ht_duplicate copies src. Keys of the copy are given by serializer. */
+struct htable* ht_duplicate(const struct htable* src,
+        ht_pl_duplicator copy, ht_pl_serializer serializer);
+/** ht_insert binds payload to key in table.
+ ** A payload already bound to key is destroyed and replaced.
+ ** insertion tells if key was not already in table. */
+bool ht_insert(struct htable* table, const char* key, uint64_t hash,
+        void* payload, ht_pl_destructor destructor, bool* insertion);
+/** ht_remove unbinds key in table and returns its payload (not destroyed)
+ ** or NULL if key is not in table. */
+void* ht_remove(struct htable* table, const char* key, uint64_t hash);
+/** ht_lookup returns the payload bound to key or NULL.
+ ** hash must be ht_hash(key). */
+void* ht_lookup(const struct htable* table, const char* key, uint64_t hash);
+/** ht_size returns the number of entries in table. */
+size_t ht_size(const struct htable* table);
+/** ht_keys returns the list of all keys contained in table sorted by strcmp.
+ ** Caller is responsible for calling free on the returned list. */
+const char** ht_keys(const struct htable* table, size_t* len);
+
+#endif
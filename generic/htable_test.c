@@ -0,0 +1,141 @@
+#include "htable.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../vendor/snow/snow/snow.h"
+
+struct payload {
+    char key[12];
+    int value;
+};
+
+static struct payload* payload_alloc(int value) {
+    struct payload* pl = calloc(1, sizeof(struct payload));
+    pl->value = value;
+    snprintf(pl->key, sizeof(pl->key), "k%d", value);
+    return pl;
+}
+
+static void* payload_copy(const void* srcv) {
+    struct payload* src = (struct payload*)srcv;
+    struct payload* dest = payload_alloc(src->value);
+    return (void*)dest;
+}
+
+static void payload_free(void* datav) {
+    struct payload* data = (struct payload*)datav;
+    free(data);
+}
+
+static const char* payload_key(const void* datav) {
+    struct payload* data = (struct payload*)datav;
+    return data->key;
+}
+
+#define LENGTH(arr) (sizeof(arr)/sizeof(arr[0]))
+
+
+describe(htable, {
+    it("inits a table and frees it", {
+        struct htable* table = ht_alloc(0);
+        defer(ht_free(table, payload_free));
+        assert(ht_size(table) == 0);
+    });
+
+#define init_table(table) \
+    do { \
+        int list[] = {3, 72, 54, 42, 90, 1, 23, 99, 18, 65}; \
+        table = ht_alloc(0); \
+        defer(if (table) ht_free(table, payload_free)); \
+        for (size_t i = 0; i < LENGTH(list); i++) { \
+            bool insertion = false; \
+            struct payload* pl = payload_alloc(list[i]); \
+            assert(ht_insert(table, pl->key, ht_hash(pl->key), \
+                        pl, payload_free, &insertion)); \
+            assert(insertion); \
+        } \
+        assert(ht_size(table) == LENGTH(list)); \
+    } while (0);
+
+    it("lookups for existing element into a table", {
+        struct htable* table = NULL;
+        init_table(table);
+        const struct payload* got = ht_lookup(table, "k42", ht_hash("k42"));
+        assert(got && got->value == 42);
+    });
+
+    it("lookups for non existing element into a table", {
+        struct htable* table = NULL;
+        init_table(table);
+        assert(!ht_lookup(table, "k0", ht_hash("k0")));
+    });
+
+    it("overrides an existing element", {
+        struct htable* table = NULL;
+        init_table(table);
+        bool insertion = true;
+        struct payload* pl = payload_alloc(42);
+        pl->value = -42;
+        assert(ht_insert(table, pl->key, ht_hash(pl->key),
+                    pl, payload_free, &insertion));
+        assert(!insertion);
+        assert(ht_size(table) == 10);
+        const struct payload* got = ht_lookup(table, "k42", ht_hash("k42"));
+        assert(got && got->value == -42);
+    });
+
+    it("removes elements, the others are still found", {
+        struct htable* table = ht_alloc(0);
+        defer(ht_free(table, payload_free));
+        for (int i = 0; i < 200; i++) {
+            bool insertion = false;
+            struct payload* pl = payload_alloc(i);
+            assert(ht_insert(table, pl->key, ht_hash(pl->key),
+                        pl, payload_free, &insertion));
+        }
+        for (int i = 0; i < 200; i += 2) {
+            char key[12];
+            snprintf(key, sizeof(key), "k%d", i);
+            struct payload* pl = ht_remove(table, key, ht_hash(key));
+            assert(pl && pl->value == i);
+            payload_free(pl);
+        }
+        assert(ht_remove(table, "k0", ht_hash("k0")) == NULL);
+        assert(ht_size(table) == 100);
+        for (int i = 0; i < 200; i++) {
+            char key[12];
+            snprintf(key, sizeof(key), "k%d", i);
+            const struct payload* got = ht_lookup(table, key, ht_hash(key));
+            assert((i % 2 == 0) ? !got : (got && got->value == i));
+        }
+    });
+
+    it("returns sorted keys", {
+        struct htable* table = NULL;
+        init_table(table);
+        size_t len = 0;
+        const char** keys = ht_keys(table, &len);
+        defer(free(keys));
+        assert(len == 10);
+        for (size_t k = 1; k < len; k++) {
+            assert(strcmp(keys[k-1], keys[k]) < 0);
+        }
+    });
+
+    it("copies a table, frees original, lookup in copy", {
+        struct htable* src = NULL;
+        init_table(src);
+        size_t size_src = ht_size(src);
+        struct htable* dest = ht_duplicate(src, payload_copy, payload_key);
+        defer(ht_free(dest, payload_free));
+        assert(ht_size(dest) == size_src);
+        ht_free(src, payload_free);
+        src = NULL;
+        assert(ht_size(dest) == size_src);
+        const struct payload* got = ht_lookup(dest, "k42", ht_hash("k42"));
+        assert(got && got->value == 42);
+    });
+});
+
+snow_main();
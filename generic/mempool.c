@@ -64,22 +64,36 @@ static const uint64_t mp_mask_init = 0x8000000000000000;
 /** mp_block_size is the total size of a block in this pool. */
 #define mp_block_size(pool) ((size_t)(pool->block_size + mp_header_size))
 
-/** mp_header_ptr is the address of the header of the block at index. */
+/** mp_header_ptr is the address of the header of the block at index.
+ ** Blocks are not aligned: the header is read and written by
+ ** mp_header_get and mp_header_set. */
 #define mp_header_ptr(pool, index) \
-    ((uint64_t*)(pool->blocks + (index) * mp_block_size(pool)))
+    ((void*)(pool->blocks + (index) * mp_block_size(pool)))
 
 /** mp_header_ptr is the address of the payload of the block at index. */
 #define mp_payload_ptr(pool, index) \
     ((void*)(pool->blocks + (index) * mp_block_size(pool) + mp_header_size))
 
+/** mp_header_get returns the header of the block at index. */
+static inline uint64_t mp_header_get(const struct mp_pool* pool, size_t index) {
+    uint64_t header = 0;
+    memcpy(&header, mp_header_ptr(pool, index), sizeof(uint64_t));
+    return header;
+}
+
+/** mp_header_set sets the header of the block at index. */
+static inline void mp_header_set(struct mp_pool* pool, size_t index, uint64_t header) {
+    memcpy(mp_header_ptr(pool, index), &header, sizeof(uint64_t));
+}
+
 /** mp_is_alive tells if the handle points to a valid block.
  ** The first 32 bits of the handle and of the header are compared. */
 #define mp_is_alive(pool, idx, alv) \
-    (pool->blockc > idx && alv && alv == (*mp_header_ptr(pool,idx) & mp_mask_alive))
+    (pool->blockc > idx && alv && alv == (mp_header_get(pool,idx) & mp_mask_alive))
 
 /** mp_is_gettable tells if the handle points to a valid block and if it has been initialized. */
 #define mp_is_gettable(pool, idx, alv) \
-    (mp_is_alive(pool, idx, alv) && (*mp_header_ptr(pool,idx) & mp_mask_init))
+    (mp_is_alive(pool, idx, alv) && (mp_header_get(pool,idx) & mp_mask_init))
 
 /** mp_print_handle is used for debugging purpose. */
 void mp_print_handle(uint64_t handle) {
@@ -101,7 +115,7 @@ struct mp_pool* mp_pool_alloc(size_t blockc, size_t block_size) {
     assert(pool->blocks);
     /* Fill the next_free list. */
     for (size_t b = 0; b < blockc; b++) {
-        *(mp_header_ptr(pool, b)) = (uint64_t)((b+1) % pool->blockc);
+        mp_header_set(pool, b, (uint64_t)((b+1) % pool->blockc));
     }
     return pool;
 }
@@ -131,6 +145,17 @@ static uint32_t mp_uniq(void) {
     return (last) ? last : 1;
 }
 
+/** mp_pool_take allocates the next free block of pool, which is not full.
+ ** init is or'ed to the header of the block. */
+static inline size_t mp_pool_take(struct mp_pool* pool, uint64_t* handle, uint64_t init) {
+    size_t index = pool->next_free;
+    pool->next_free = mp_header_get(pool, index) & mp_mask_index;
+    *handle = ((uint64_t)mp_uniq() << mp_shift_alive) + (uint64_t)index;
+    mp_header_set(pool, index, *handle | init);
+    pool->blockc_in_use++;
+    return index;
+}
+
 bool mp_alloc_from_pool(struct mp_pool* pool, uint64_t* handle) {
     if (!pool || !handle) {
         return false;
@@ -138,14 +163,17 @@ bool mp_alloc_from_pool(struct mp_pool* pool, uint64_t* handle) {
     if (mp_pool_is_full(pool)) {
         return false;
     }
-    size_t index = pool->next_free;
-    pool->next_free = *(mp_header_ptr(pool, index)) & mp_mask_index;
-    *handle = ((uint64_t)mp_uniq() << mp_shift_alive) + (uint64_t)index;
-    *(mp_header_ptr(pool, index)) = *handle;
-    pool->blockc_in_use++;
+    mp_pool_take(pool, handle, 0);
     return true;
 }
 
+void* mp_take_from_pool(struct mp_pool* pool, uint64_t* handle) {
+    if (!pool || !handle || mp_pool_is_full(pool)) {
+        return NULL;
+    }
+    return mp_payload_ptr(pool, mp_pool_take(pool, handle, mp_mask_init));
+}
+
 bool mp_free_from_pool(struct mp_pool* pool, uint64_t handle) {
     if (!pool) {
         return false;
@@ -158,7 +186,7 @@ bool mp_free_from_pool(struct mp_pool* pool, uint64_t handle) {
     if (!mp_is_alive(pool, index, alive)) {
         return false;
     }
-    *(mp_header_ptr(pool, index)) = (uint64_t)pool->next_free;
+    mp_header_set(pool, index, (uint64_t)pool->next_free);
     pool->next_free = index;
     pool->blockc_in_use--;
     return true;
@@ -185,7 +213,7 @@ bool mp_put_to_pool(struct mp_pool* pool, uint64_t handle, const void* block) {
     if (!mp_is_alive(pool, index, alive)) {
         return false;
     }
-    *mp_header_ptr(pool, index) |= mp_mask_init; // Set init bit.
+    mp_header_set(pool, index, mp_header_get(pool, index) | mp_mask_init); // Set init bit.
     memcpy(mp_payload_ptr(pool, index),
             block, pool->block_size);
     return true;
@@ -306,6 +334,23 @@ bool mp_alloc_from_cluster(struct mp_cluster* cluster, uint64_t* handle) {
     return true;
 }
 
+void* mp_take_from_cluster(struct mp_cluster* cluster, uint64_t* handle) {
+    if (!cluster) {
+        return NULL;
+    }
+    size_t pool_idx = cluster->next_free;
+    struct mp_pool* pool = cluster->pools[pool_idx];
+    void* block = mp_take_from_pool(pool, handle);
+    if (!block) {
+        return NULL;
+    }
+    *handle = *handle + ((uint64_t)pool_idx << cluster->shift_pool_idx);
+    if (mp_pool_is_full(pool) && cluster->next_free == pool_idx) {
+        mp_cluster_grow(cluster);
+    }
+    return block;
+}
+
 bool mp_free_from_cluster(struct mp_cluster* cluster, uint64_t handle) {
     if (!cluster) {
         return false;
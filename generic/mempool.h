@@ -22,6 +22,8 @@ bool mp_pool_is_empty(struct mp_pool*);
 bool mp_pool_is_full(struct mp_pool*);
 /** mp_alloc_from_pool allocates a new block from the pool. See mp_alloc. */
 bool mp_alloc_from_pool(struct mp_pool*, uint64_t* handle);
+/** mp_take_from_pool allocates a new block from the pool. See mp_take. */
+void* mp_take_from_pool(struct mp_pool*, uint64_t* handle);
 /** mp_free_from_pool frees the block designated by handle. See mp_free. */
 bool mp_free_from_pool(struct mp_pool*, uint64_t handle);
 /** mp_get_from_pool returns a pointer to the content of the block designated by handle.
@@ -42,6 +44,8 @@ size_t mp_cluster_size(struct mp_cluster*);
 bool mp_cluster_is_empty(struct mp_cluster*);
 /** mp_alloc_from_cluster allocates a new block from the cluster. See mp_alloc. */
 bool mp_alloc_from_cluster(struct mp_cluster*, uint64_t* handle);
+/** mp_take_from_cluster allocates a new block from the cluster. See mp_take. */
+void* mp_take_from_cluster(struct mp_cluster*, uint64_t* handle);
 /** mp_free_from_cluster frees the block designated by handle. See mp_free. */
 bool mp_free_from_cluster(struct mp_cluster*, uint64_t handle);
 /** mp_get_from_cluster returns a pointer to the content of the block designated by handle.
@@ -55,6 +59,13 @@ bool mp_put_to_cluster(struct mp_cluster*, uint64_t handle, const void* block);
 #define mp_alloc(pool, handle) _Generic((pool), \
         struct mp_pool*:    mp_alloc_from_pool, \
         struct mp_cluster*: mp_alloc_from_cluster)(pool, handle)
+/** mp_take allocates a block, sets handle and returns a pointer to its content.
+ ** The block is initialized (it can be get) but its content is undefined.
+ ** Unlike mp_get, the returned pointer gives direct read-write access to memory.
+ ** mp_take returns NULL if no block could be allocated. */
+#define mp_take(pool, handle) _Generic((pool), \
+        struct mp_pool*:    mp_take_from_pool, \
+        struct mp_cluster*: mp_take_from_cluster)(pool, handle)
 /** mp_free frees the block designated by handle. */
 #define mp_free(pool, handle) _Generic((pool), \
         struct mp_pool*:    mp_free_from_pool, \
@@ -24,6 +24,34 @@ describe(mempool, {
         assert(mp_free(pool, idx1));
     });
 
+    it("takes a writable block from a mempool", {
+        struct mp_pool* pool = mp_pool_alloc(1, sizeof(int));
+        defer(mp_pool_free(&pool));
+        uint64_t idx1, idx2;
+        int *got = NULL;
+        assert(got = (int*)mp_take(pool, &idx1));
+        *got = -10;
+        assert(*(const int*)mp_get(pool, idx1) == -10);
+        assert(NULL == mp_take(pool, &idx2));
+        assert(mp_free(pool, idx1));
+        assert(NULL == mp_get(pool, idx1));
+    });
+
+    it("takes writable blocks from a cluster", {
+        struct mp_cluster* cluster = mp_cluster_alloc(mp_pool_alloc(1, sizeof(int)));
+        defer(mp_cluster_free(&cluster));
+        uint64_t idx1, idx2;
+        int *got1 = NULL, *got2 = NULL;
+        assert(got1 = (int*)mp_take(cluster, &idx1));
+        assert(got2 = (int*)mp_take(cluster, &idx2));
+        *got1 = 1;
+        *got2 = 2;
+        assert(*(const int*)mp_get(cluster, idx1) == 1);
+        assert(*(const int*)mp_get(cluster, idx2) == 2);
+        assert(mp_free(cluster, idx1));
+        assert(mp_free(cluster, idx2));
+    });
+
     it("fails to put to not allocated blocks", {
         struct mp_pool* pool = mp_pool_alloc(2, sizeof(int));
         defer(mp_pool_free(&pool));
@@ -22,6 +22,7 @@ const struct lfunc lbuiltin_op_add = {
     .guards       = &guards_op_add[0],
     .guardc       = LENGTH(guards_op_add),
     .func         = lbi_op_add,
+    .reduce       = lbi_reduce_add,
 };
 
 static const struct lguard guards_op_sub[] = {
@@ -36,6 +37,7 @@ const struct lfunc lbuiltin_op_sub = {
     .guards       = &guards_op_sub[0],
     .guardc       = LENGTH(guards_op_sub),
     .func         = lbi_op_sub,
+    .reduce       = lbi_reduce_sub,
 };
 
 static const struct lguard guards_op_mul[] = {
@@ -50,6 +52,7 @@ const struct lfunc lbuiltin_op_mul = {
     .guards       = &guards_op_mul[0],
     .guardc       = LENGTH(guards_op_mul),
     .func         = lbi_op_mul,
+    .reduce       = lbi_reduce_mul,
 };
 
 static const struct lguard guards_op_div[] = {
@@ -65,6 +68,7 @@ const struct lfunc lbuiltin_op_div = {
     .guards       = &guards_op_div[0],
     .guardc       = LENGTH(guards_op_div),
     .func         = lbi_op_div,
+    .reduce       = lbi_reduce_div,
 };
 
 static const struct lguard guards_op_mod[] = {
@@ -80,6 +84,7 @@ const struct lfunc lbuiltin_op_mod = {
     .guards       = &guards_op_mod[0],
     .guardc       = LENGTH(guards_op_mod),
     .func         = lbi_op_mod,
+    .reduce       = lbi_reduce_mod,
 };
 
 static const struct lguard guards_op_fac[] = {
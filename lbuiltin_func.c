@@ -17,17 +17,17 @@
 
 int lbi_func_if(struct lenv* env, const struct lval* args, struct lval* acc) {
     /* Retrieve arg 1: boolean. */
-    struct lval* boolean = lval_alloc();
+    struct lval* boolean = lval_alloc_tmp();
     lval_index(args, 0, boolean);
     /* Retrieve arg 2 or 3: branch. */
-    struct lval* branch = lval_alloc();
+    struct lval* branch = lval_alloc_tmp();
     if (lval_as_bool(boolean)) {
         lval_index(args, 1, branch);
     } else {
         lval_index(args, 2, branch);
     }
     /* Eval. */
-    struct lval* wrap = lval_alloc();
+    struct lval* wrap = lval_alloc_tmp();
     lval_mut_sexpr(wrap);
     lval_push(wrap, branch);
     int s = lfunc_exec(&lbuiltin_eval, env, wrap, acc);
@@ -40,26 +40,30 @@ int lbi_func_if(struct lenv* env, const struct lval* args, struct lval* acc) {
 
 int lbi_func_loop(struct lenv* env, const struct lval* args, struct lval* acc) {
     /* Retrieve arg 1: boolean. */
-    struct lval* branch_cond = lval_alloc();
+    struct lval* branch_cond = lval_alloc_tmp();
     lval_index(args, 0, branch_cond);
-    struct lval* wrap_cond = lval_alloc();
+    struct lval* wrap_cond = lval_alloc_tmp();
     lval_mut_sexpr(wrap_cond);
     lval_push(wrap_cond, branch_cond);
     /* Retrieve arg 2 or 3: branch. */
-    struct lval* branch_body = lval_alloc();
+    struct lval* branch_body = lval_alloc_tmp();
     lval_index(args, 1, branch_body);
-    struct lval* wrap_body = lval_alloc();
+    struct lval* wrap_body = lval_alloc_tmp();
     lval_mut_sexpr(wrap_body);
     lval_push(wrap_body, branch_body);
     /* Loop. */
     int s = 0;
-    struct lval* boolean = lval_alloc();
+    struct lval* boolean = lval_alloc_tmp();
     while (0 == (s = lfunc_exec(&lbuiltin_eval, env, wrap_cond, boolean)) && lval_as_bool(boolean)) {
         s = lfunc_exec(&lbuiltin_eval, env, wrap_body, acc);
         if (s != 0) {
             break;
         }
     }
+    /* The condition failed: the error is the result. */
+    if (lval_type(boolean) == LVAL_ERR) {
+        lval_dup(acc, boolean);
+    }
     lval_free(boolean);
     /* Cleanup. */
     lval_free(wrap_cond);
@@ -72,7 +76,7 @@ int lbi_func_loop(struct lenv* env, const struct lval* args, struct lval* acc) {
 int lbi_func_head(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
     /* Retrieve arg 1. */
-    struct lval* arg = lval_alloc();
+    struct lval* arg = lval_alloc_tmp();
     lval_index(args, 0, arg);
     /* Head. */
     lval_index(arg, 0, acc);
@@ -83,7 +87,7 @@ int lbi_func_head(struct lenv* env, const struct lval* args, struct lval* acc) {
 int lbi_func_tail(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
     /* Retrieve arg 1. */
-    struct lval* arg = lval_alloc();
+    struct lval* arg = lval_alloc_tmp();
     lval_index(args, 0, arg);
     lval_copy(acc, arg);
     lval_free(arg);
@@ -95,7 +99,7 @@ int lbi_func_tail(struct lenv* env, const struct lval* args, struct lval* acc) {
 int lbi_func_init(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
     /* Retrieve arg 1. */
-    struct lval* arg = lval_alloc();
+    struct lval* arg = lval_alloc_tmp();
     lval_index(args, 0, arg);
     lval_copy(acc, arg);
     lval_free(arg);
@@ -108,7 +112,7 @@ int lbi_func_init(struct lenv* env, const struct lval* args, struct lval* acc) {
 int lbi_func_last(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
     /* Retrieve arg 1. */
-    struct lval* list = lval_alloc();
+    struct lval* list = lval_alloc_tmp();
     lval_index(args, 0, list);
     /* Last. */
     size_t len = lval_len(list);
@@ -120,10 +124,10 @@ int lbi_func_last(struct lenv* env, const struct lval* args, struct lval* acc) {
 int lbi_func_index(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
     /* Retrieve arg 1: index. */
-    struct lval* idx = lval_alloc();
+    struct lval* idx = lval_alloc_tmp();
     lval_index(args, 0, idx);
     /* Retrieve arg 2: list. */
-    struct lval* list = lval_alloc();
+    struct lval* list = lval_alloc_tmp();
     lval_index(args, 1, list);
     /* Index. */
     long i = 0;
@@ -142,14 +146,14 @@ int lbi_func_index(struct lenv* env, const struct lval* args, struct lval* acc)
 int lbi_func_elem(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
     /* Retrieve arg 1: elem. */
-    struct lval* elem = lval_alloc();
+    struct lval* elem = lval_alloc_tmp();
     lval_index(args, 0, elem);
     /* Retrieve arg 2: list. */
-    struct lval* list = lval_alloc();
+    struct lval* list = lval_alloc_tmp();
     lval_index(args, 1, list);
     /* Elem. */
     size_t len = lval_len(list);
-    struct lval* child = lval_alloc();
+    struct lval* child = lval_alloc_tmp();
     lval_mut_bool(acc, false);
     for (size_t e = 0; e < len; e++) {
         lval_index(list, e, child);
@@ -168,10 +172,10 @@ int lbi_func_elem(struct lenv* env, const struct lval* args, struct lval* acc) {
 int lbi_func_take(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
     /* Retrieve arg 1: index. */
-    struct lval* idx = lval_alloc();
+    struct lval* idx = lval_alloc_tmp();
     lval_index(args, 0, idx);
     /* Retrieve arg 2: list. */
-    struct lval* list = lval_alloc();
+    struct lval* list = lval_alloc_tmp();
     lval_index(args, 1, list);
     /* Take. */
     long i = 0;
@@ -198,10 +202,10 @@ int lbi_func_take(struct lenv* env, const struct lval* args, struct lval* acc) {
 int lbi_func_drop(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
     /* Retrieve arg 1: index. */
-    struct lval* idx = lval_alloc();
+    struct lval* idx = lval_alloc_tmp();
     lval_index(args, 0, idx);
     /* Retrieve arg 2: list. */
-    struct lval* list = lval_alloc();
+    struct lval* list = lval_alloc_tmp();
     lval_index(args, 1, list);
     /* Drop. */
     long i = 0;
@@ -228,22 +232,23 @@ int lbi_func_drop(struct lenv* env, const struct lval* args, struct lval* acc) {
 int lbi_func_cons(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
     /* Retrieve arg 1. */
-    struct lval* arg = lval_alloc();
+    struct lval* arg = lval_alloc_tmp();
     lval_index(args, 0, arg);
-    struct lval* list = lval_alloc();
+    struct lval* list = lval_alloc_tmp();
     lval_index(args, 1, list);
     /* Cons. */
     lval_dup(acc, list);
-    lval_cons(acc, arg);
-    lval_free(arg);
     lval_free(list);
+    if (!lval_cons_move(acc, arg)) {
+        lval_free(arg);
+    }
     return 0;
 }
 
 int lbi_func_len(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
     /* Retrieve arg 1. */
-    struct lval* arg = lval_alloc();
+    struct lval* arg = lval_alloc_tmp();
     lval_index(args, 0, arg);
     /* Len. */
     size_t len = lval_len(arg);
@@ -263,7 +268,7 @@ int lbi_func_join(struct lenv* env, const struct lval* args, struct lval* acc) {
         }
     }
     size_t len = lval_len(args);
-    struct lval* child = lval_alloc();
+    struct lval* child = lval_alloc_tmp();
     for (size_t c = 0; c < len; c++) {
         lval_index(args, c, child);
         lval_push(acc, child);
@@ -274,7 +279,7 @@ int lbi_func_join(struct lenv* env, const struct lval* args, struct lval* acc) {
 
 int lbi_func_list(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
-    struct lval* tmp = lval_alloc();
+    struct lval* tmp = lval_alloc_tmp();
     lval_dup(tmp, args);
     lval_push(acc, args);
     lval_free(tmp);
@@ -284,13 +289,13 @@ int lbi_func_list(struct lenv* env, const struct lval* args, struct lval* acc) {
 int lbi_func_seq(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
     /* Retrieve arg 1: first. */
-    struct lval* vfirst = lval_alloc();
+    struct lval* vfirst = lval_alloc_tmp();
     lval_index(args, 0, vfirst);
     /* Retrieve arg 2: last. */
-    struct lval* vlast = lval_alloc();
+    struct lval* vlast = lval_alloc_tmp();
     lval_index(args, 1, vlast);
     /* Retrieve arg 3: step. */
-    struct lval* vstep = lval_alloc();
+    struct lval* vstep = lval_alloc_tmp();
     lval_index(args, 2, vstep);
     /* Sequence. */
     long first, last, step;
@@ -304,7 +309,7 @@ int lbi_func_seq(struct lenv* env, const struct lval* args, struct lval* acc) {
     if (first > last && step > 0) {
         step *= -1;
     }
-    struct lval* vi = lval_alloc();
+    struct lval* vi = lval_alloc_tmp();
     for (long i = first; (step > 0 && i <= last) || (step < 0 && i >= last); i += step) {
         lval_mut_num(vi, i);
         lval_push(acc, vi);
@@ -320,32 +325,32 @@ int lbi_func_seq(struct lenv* env, const struct lval* args, struct lval* acc) {
 int lbi_func_eval(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
     /* Retrieve arg 1. */
-    struct lval* arg = lval_alloc();
+    struct lval* arg = lval_alloc_tmp();
     lval_index(args, 0, arg);
     /* Mut Q-Expression in S-Expr. */
     if (lval_type(arg) == LVAL_QEXPR) {
-        struct lval* cpy = lval_alloc();
+        struct lval* cpy = lval_alloc_tmp();
         lval_copy(cpy, arg);
         lval_mut_sexpr(cpy);
         lval_free(arg);
         arg = cpy;
     }
     /* Eval. */
-    struct lval* r = lval_alloc();
+    struct lval* r = lval_alloc_tmp();
     bool s = leval(env, arg, r);
     lval_free(arg);
-    lval_copy(acc, r);
+    lval_move(acc, r);
     lval_free(r);
     return !s;
 }
 
 int lbi_func_map(struct lenv* env, const struct lval* args, struct lval* acc) {
     /* Retrieve arg 1: function. */
-    struct lval* func = lval_alloc();
+    struct lval* func = lval_alloc_tmp();
     lval_index(args, 0, func);
     const struct lfunc* func_ptr = lval_as_func(func);
     /* Retrieve arg 2: list. */
-    struct lval* list = lval_alloc();
+    struct lval* list = lval_alloc_tmp();
     lval_index(args, 1, list);
     switch (lval_type(list)) {
         case LVAL_STR:   lval_mut_str(acc, ""); break;
@@ -355,30 +360,23 @@ int lbi_func_map(struct lenv* env, const struct lval* args, struct lval* acc) {
     /* Map. */
     int s = 0;
     size_t len = lval_len(list);
-    size_t len_bound = lval_len(func_ptr->args);
-    struct lval* elem = lval_alloc();
-    struct lval* res = lval_alloc();
-    struct lval* wrap = lval_alloc();
+    struct lval* elem = lval_alloc_tmp();
+    const struct lval* argv[] = {elem};
     for (size_t e = 0; e < len; e++) {
         lval_index(list, e, elem);
-        lval_clear(res);
-        lval_clear(wrap);
-        lval_mut_qexpr(wrap);
-        lval_push(wrap, elem);
-        /* Elem is added to func_ptr->args. */
-        s = lfunc_exec(func_ptr, env, wrap, res);
+        struct lval* res = lval_alloc_tmp();
+        s = lfunc_apply(func_ptr, env, 1, argv, res);
         if (s != 0) {
-            lval_dup(acc, res);
+            lval_move(acc, res);
+            lval_free(res);
             s = e+1;
             break;
         }
-        /* Drop last argument. */
-        lval_drop(func_ptr->args, len_bound);
-        lval_push(acc, res);
+        if (!lval_push_move(acc, res)) {
+            lval_free(res);
+        }
     }
     lval_free(elem);
-    lval_free(res);
-    lval_free(wrap);
     /* Cleanup. */
     lval_free(func);
     lval_free(list);
@@ -387,11 +385,11 @@ int lbi_func_map(struct lenv* env, const struct lval* args, struct lval* acc) {
 
 int lbi_func_filter(struct lenv* env, const struct lval* args, struct lval* acc) {
     /* Retrieve arg 1: function. */
-    struct lval* func = lval_alloc();
+    struct lval* func = lval_alloc_tmp();
     lval_index(args, 0, func);
     const struct lfunc* func_ptr = lval_as_func(func);
     /* Retrieve arg 2: list. */
-    struct lval* list = lval_alloc();
+    struct lval* list = lval_alloc_tmp();
     lval_index(args, 1, list);
     switch (lval_type(list)) {
         case LVAL_STR:   lval_mut_str(acc, ""); break;
@@ -401,32 +399,24 @@ int lbi_func_filter(struct lenv* env, const struct lval* args, struct lval* acc)
     /* Filter. */
     int s = 0;
     size_t len = lval_len(list);
-    size_t len_bound = lval_len(func_ptr->args);
-    struct lval* elem = lval_alloc();
-    struct lval* res = lval_alloc();
-    struct lval* wrap = lval_alloc();
+    struct lval* elem = lval_alloc_tmp();
+    struct lval* res = lval_alloc_tmp();
+    const struct lval* argv[] = {elem};
     for (size_t e = 0; e < len; e++) {
         lval_index(list, e, elem);
         lval_clear(res);
-        lval_clear(wrap);
-        lval_mut_qexpr(wrap);
-        lval_push(wrap, elem);
-        /* Elem is added to func_ptr->args. */
-        s = lfunc_exec(func_ptr, env, wrap, res);
+        s = lfunc_apply(func_ptr, env, 1, argv, res);
         if (s != 0) {
             lval_dup(acc, res);
             s = e+1;
             break;
         }
-        /* Drop last argument. */
-        lval_drop(func_ptr->args, len_bound);
         if (lval_as_bool(res)) {
             lval_push(acc, elem);
         }
     }
     lval_free(elem);
     lval_free(res);
-    lval_free(wrap);
     /* Cleanup. */
     lval_free(func);
     lval_free(list);
@@ -435,40 +425,30 @@ int lbi_func_filter(struct lenv* env, const struct lval* args, struct lval* acc)
 
 int lbi_func_fold(struct lenv* env, const struct lval* args, struct lval* acc) {
     /* Retrieve arg 1: function. */
-    struct lval* func = lval_alloc();
+    struct lval* func = lval_alloc_tmp();
     lval_index(args, 0, func);
     const struct lfunc* func_ptr = lval_as_func(func);
     /* Retrieve arg 2: initial value. */
-    struct lval* init = lval_alloc();
+    struct lval* init = lval_alloc_tmp();
     lval_index(args, 1, init);
     /* Retrieve arg 3: list. */
-    struct lval* list = lval_alloc();
+    struct lval* list = lval_alloc_tmp();
     lval_index(args, 2, list);
     /* Fold. */
     int s = 0;
     size_t len = lval_len(list);
-    size_t len_bound = lval_len(func_ptr->args);
-    struct lval* elem = lval_alloc();
-    struct lval* wrap = lval_alloc();
+    struct lval* elem = lval_alloc_tmp();
+    const struct lval* argv[] = {acc, elem};
     lval_dup(acc, init);
     for (size_t e = 0; e < len; e++) {
         lval_index(list, e, elem);
-        lval_clear(wrap);
-        lval_mut_qexpr(wrap);
-        lval_push(wrap, acc);
-        lval_push(wrap, elem);
-        /* Elem is added to func_ptr->args. */
-        s = lfunc_exec(func_ptr, env, wrap, acc);
+        s = lfunc_apply(func_ptr, env, 2, argv, acc);
         if (s != 0) {
             s = e+1;
             break;
         }
-        /* Drop last argument. */
-        lval_drop(func_ptr->args, len_bound); // arg.
-        lval_drop(func_ptr->args, len_bound); // acc.
     }
     lval_free(elem);
-    lval_free(wrap);
     /* Cleanup. */
     lval_free(func);
     lval_free(init);
@@ -479,7 +459,7 @@ int lbi_func_fold(struct lenv* env, const struct lval* args, struct lval* acc) {
 int lbi_func_reverse(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
     /* Retrieve arg 1: list. */
-    struct lval* list = lval_alloc();
+    struct lval* list = lval_alloc_tmp();
     lval_index(args, 0, list);
     /* Reverse. */
     lval_reverse(acc, list);
@@ -490,24 +470,20 @@ int lbi_func_reverse(struct lenv* env, const struct lval* args, struct lval* acc
 
 static int lbuiltin_test(struct lenv* env, const struct lval* args, struct lval* acc, bool break_on) {
     /* Retrieve arg 1: condition function. */
-    struct lval* func = lval_alloc();
+    struct lval* func = lval_alloc_tmp();
     lval_index(args, 0, func);
     const struct lfunc* func_ptr = lval_as_func(func);
     /* Retrieve arg 2: list. */
-    struct lval* list = lval_alloc();
+    struct lval* list = lval_alloc_tmp();
     lval_index(args, 1, list);
     /* All. */
     int s = 0;
     size_t len = lval_len(list);
-    size_t len_bound = lval_len(func_ptr->args);
-    struct lval* elem = lval_alloc();
-    struct lval* wrap = lval_alloc();
+    struct lval* elem = lval_alloc_tmp();
+    const struct lval* argv[] = {elem};
     for (size_t e = 0; e < len; e++) {
         lval_index(list, e, elem);
-        lval_clear(wrap);
-        lval_mut_qexpr(wrap);
-        lval_push(wrap, elem);
-        s = lfunc_exec(func_ptr, env, wrap, acc);
+        s = lfunc_apply(func_ptr, env, 1, argv, acc);
         if (s != 0) {
             s = e+1;
             break;
@@ -516,10 +492,8 @@ static int lbuiltin_test(struct lenv* env, const struct lval* args, struct lval*
          || (break_on == true  &&  lval_as_bool(acc))) {
             break;
         }
-        lval_drop(func_ptr->args, len_bound); // arg.
     }
     lval_free(elem);
-    lval_free(wrap);
     /* Cleanup. */
     lval_free(func);
     lval_free(list);
@@ -537,27 +511,26 @@ int lbi_func_any(struct lenv* env, const struct lval* args, struct lval* acc) {
 int lbi_func_zip(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
     /* Retrieve arg 1: list. */
-    struct lval* list0 = lval_alloc();
+    struct lval* list0 = lval_alloc_tmp();
     lval_index(args, 0, list0);
     size_t len0 = lval_len(list0);
     /* Retrieve arg 2: list. */
-    struct lval* list1 = lval_alloc();
+    struct lval* list1 = lval_alloc_tmp();
     lval_index(args, 1, list1);
     size_t len1 = lval_len(list1);
     /* Zip. */
     size_t len = (len0 < len1) ? len0 : len1;
     lval_mut_qexpr(acc);
-    struct lval* elem0 = lval_alloc();
-    struct lval* elem1 = lval_alloc();
+    struct lval* elem0 = lval_alloc_tmp();
+    struct lval* elem1 = lval_alloc_tmp();
     for (size_t e = 0; e < len; e++) {
-        struct lval* zipped = lval_alloc();
+        struct lval* zipped = lval_alloc_tmp();
         lval_mut_qexpr(zipped);
         lval_index(list0, e, elem0);
         lval_index(list1, e, elem1);
         lval_push(zipped, elem0);
         lval_push(zipped, elem1);
-        lval_push(acc, zipped);
-        lval_free(zipped);
+        lval_push_move(acc, zipped);
     }
     lval_free(elem0);
     lval_free(elem1);
@@ -570,7 +543,7 @@ int lbi_func_zip(struct lenv* env, const struct lval* args, struct lval* acc) {
 int lbi_func_sort(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
     /* Retrieve arg 1: list. */
-    struct lval* list = lval_alloc();
+    struct lval* list = lval_alloc_tmp();
     lval_index(args, 0, list);
     /* Sort. */
     lval_sort(list);
@@ -583,7 +556,7 @@ int lbi_func_sort(struct lenv* env, const struct lval* args, struct lval* acc) {
 int lbi_func_mix(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
     /* Retrieve arg 1: list. */
-    struct lval* list = lval_alloc();
+    struct lval* list = lval_alloc_tmp();
     lval_index(args, 0, list);
     /* Mix. */
     static bool init = false;
@@ -605,10 +578,10 @@ int lbi_func_mix(struct lenv* env, const struct lval* args, struct lval* acc) {
 int lbi_func_repeat(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
     /* Retrieve arg 1: times. */
-    struct lval* vtimes = lval_alloc();
+    struct lval* vtimes = lval_alloc_tmp();
     lval_index(args, 0, vtimes);
     /* Retrieve arg 2: list. */
-    struct lval* list = lval_alloc();
+    struct lval* list = lval_alloc_tmp();
     lval_index(args, 1, list);
     /* Repeat. */
     long times;
@@ -632,8 +605,8 @@ static int lbi_def(struct lenv* env,
     /* Define symbols. */
     size_t len = lval_len(symbols);
     for (size_t c = 0; c < len; c++) {
-        struct lval* sym = lval_alloc();
-        struct lval* value = lval_alloc();
+        struct lval* sym = lval_alloc_tmp();
+        struct lval* value = lval_alloc_tmp();
         lval_index(symbols, c, sym);
         lval_index(values, c, value);
         if (!def(env, sym, value)) {
@@ -650,10 +623,10 @@ static int lbi_def(struct lenv* env,
 
 int lbi_func_def(struct lenv* env, const struct lval* args, struct lval* acc) {
     /* Retrieve arg 1: list of symbols. */
-    struct lval* symbols = lval_alloc();
+    struct lval* symbols = lval_alloc_tmp();
     lval_index(args, 0, symbols);
     /* Retrieve arg 2...n: list of values. */
-    struct lval* values = lval_alloc();
+    struct lval* values = lval_alloc_tmp();
     lval_copy(values, args);
     lval_drop(values, 0); // Drops list of symbols.
     /* Def. */
@@ -666,10 +639,10 @@ int lbi_func_def(struct lenv* env, const struct lval* args, struct lval* acc) {
 
 int lbi_func_override(struct lenv* env, const struct lval* args, struct lval* acc) {
     /* Retrieve arg 1: list of symbols. */
-    struct lval* symbols = lval_alloc();
+    struct lval* symbols = lval_alloc_tmp();
     lval_index(args, 0, symbols);
     /* Retrieve arg 2...n: list of values. */
-    struct lval* values = lval_alloc();
+    struct lval* values = lval_alloc_tmp();
     lval_copy(values, args);
     lval_drop(values, 0); // Drops list of symbols.
     /* Def. */
@@ -682,10 +655,10 @@ int lbi_func_override(struct lenv* env, const struct lval* args, struct lval* ac
 
 int lbi_func_put(struct lenv* env, const struct lval* args, struct lval* acc) {
     /* Retrieve arg 1: list of symbols. */
-    struct lval* symbols = lval_alloc();
+    struct lval* symbols = lval_alloc_tmp();
     lval_index(args, 0, symbols);
     /* Retrieve arg 2...n: list of values. */
-    struct lval* values = lval_alloc();
+    struct lval* values = lval_alloc_tmp();
     lval_copy(values, args);
     lval_drop(values, 0); // Drops list of symbols.
     /* Def. */
@@ -703,10 +676,10 @@ static int lbi_func_call(struct lenv* env, const struct lval* args, struct lval*
 int lbi_func_lambda(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
     /* Retrieve arg 1: list of formals. */
-    struct lval* formals = lval_alloc();
+    struct lval* formals = lval_alloc_tmp();
     lval_index(args, 0, formals);
     /* Retrieve arg 1: list of sexpr. */
-    struct lval* body = lval_alloc();
+    struct lval* body = lval_alloc_tmp();
     lval_index(args, 1, body);
     /* Argument count. */
     size_t argc = lval_len(formals);
@@ -714,7 +687,7 @@ int lbi_func_lambda(struct lenv* env, const struct lval* args, struct lval* acc)
     int max_argc = argc;
     /* Special case when & is the argument right before last one. */
     if (argc >= 2) {
-        struct lval* bef_last = lval_alloc();
+        struct lval* bef_last = lval_alloc_tmp();
         lval_index(formals, argc - 2, bef_last);
         if (strcmp("&", lval_as_sym(bef_last)) == 0) {
             min_argc -= 2; // Remove &; last is optional.
@@ -732,6 +705,7 @@ int lbi_func_lambda(struct lenv* env, const struct lval* args, struct lval* acc)
     lfunc_init(&func);
     lval_dup(func.formals, formals);
     lval_dup(func.body, body);
+    lfunc_resolve(&func);
     /* Put lambda in acc. */
     lval_mut_func(acc, &func);
     /* Cleanup. */
@@ -744,17 +718,17 @@ int lbi_func_lambda(struct lenv* env, const struct lval* args, struct lval* acc)
 int lbi_func_fun(struct lenv* env, const struct lval* args, struct lval* acc) {
     int s = 0;
     /* Retrieve arg 1: list of symbols. */
-    struct lval* symbols = lval_alloc();
+    struct lval* symbols = lval_alloc_tmp();
     lval_index(args, 0, symbols);
     /* Retrieve arg 1 first symbol: function name. */
     struct lval* name = lval_pop(symbols, 0);
     /* Retrieve arg 1: formals. */
     struct lval* formals = symbols; // For clarity.
     /* Retrieve arg 2: body. */
-    struct lval* body = lval_alloc();
+    struct lval* body = lval_alloc_tmp();
     lval_index(args, 1, body);
     /* Lambda definition. */
-    struct lval* lambda = lval_alloc();
+    struct lval* lambda = lval_alloc_tmp();
     lval_mut_qexpr(lambda);
     lval_push(lambda, formals);
     lval_push(lambda, body);
@@ -770,9 +744,9 @@ int lbi_func_fun(struct lenv* env, const struct lval* args, struct lval* acc) {
     struct lfunc* fun_ptr = lval_as_func(acc);
     lfunc_set_symbol(fun_ptr, lval_as_sym(name));
     /* Environment registration. */
-    struct lval* def = lval_alloc();
+    struct lval* def = lval_alloc_tmp();
     lval_mut_qexpr(def);
-    struct lval* def_list = lval_alloc();
+    struct lval* def_list = lval_alloc_tmp();
     lval_mut_qexpr(def_list);
     lval_push(def_list, name);
     lval_push(def, def_list);
@@ -788,30 +762,29 @@ int lbi_func_fun(struct lenv* env, const struct lval* args, struct lval* acc) {
 }
 
 int lbi_func_pack(struct lenv* env, const struct lval* args, struct lval* acc) {
-    struct lval* largs = lval_alloc();
+    struct lval* largs = lval_alloc_tmp();
     lval_copy(largs, args);
     lval_mut_qexpr(largs);
     /* Retrieve arg 1: function pointer. */
     struct lval* func_ptr = lval_pop(largs, 0);
     /* Remaining args: function arguments. */
-    struct lval* func_args = lval_alloc(); // For clarity.
+    struct lval* func_args = lval_alloc_tmp(); // For clarity.
     lval_mut_qexpr(func_args);
-    lval_push(func_args, largs);
+    lval_push_move(func_args, largs);
     /* Create Q-Expression. */
     int s = lfunc_exec(lval_as_func(func_ptr), env, func_args, acc);
     /* Cleanup. */
     lval_free(func_ptr);
     lval_free(func_args);
-    lval_free(largs);
     return s;
 }
 
 int lbi_func_unpack(struct lenv* env, const struct lval* args, struct lval* acc) {
     /* Retrieve arg 1: function pointer. */
-    struct lval* func_ptr = lval_alloc();
+    struct lval* func_ptr = lval_alloc_tmp();
     lval_index(args, 0, func_ptr);
     /* Retrieve arg 2: function arguments. */
-    struct lval* func_args = lval_alloc();
+    struct lval* func_args = lval_alloc_tmp();
     lval_index(args, 1, func_args);
     /* Eval. */
     int s = lfunc_exec(lval_as_func(func_ptr), env, func_args, acc);
@@ -823,12 +796,13 @@ int lbi_func_unpack(struct lenv* env, const struct lval* args, struct lval* acc)
 
 int lbi_func_partial(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
-    struct lval* largs = lval_alloc();
+    struct lval* largs = lval_alloc_tmp();
     lval_copy(largs, args);
     lval_mut_qexpr(largs);
     /* Retrieve arg 1: function pointer. */
     struct lval* func = lval_pop(largs, 0);
-    lval_dup(acc, func);
+    /* Copy: func may be shared with an environment binding. */
+    lval_copy(acc, func);
     struct lfunc* fun_ptr = lval_as_func(acc);
     lfunc_push_args(fun_ptr, largs);
     /* Cleanup. */
@@ -840,7 +814,7 @@ int lbi_func_partial(struct lenv* env, const struct lval* args, struct lval* acc
 int lbi_func_print(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
     size_t len = lval_len(args);
-    struct lval* arg = lval_alloc();
+    struct lval* arg = lval_alloc_tmp();
     for (size_t a = 0; a < len; a++) {
         if (a) {
             fputc(' ', stdout);
@@ -855,7 +829,7 @@ int lbi_func_print(struct lenv* env, const struct lval* args, struct lval* acc)
 }
 
 int lbi_func_load(struct lenv* env, const struct lval* args, struct lval* acc) {
-    struct lval* filev = lval_alloc();
+    struct lval* filev = lval_alloc_tmp();
     /* Evaluates each file given as argument. */
     size_t len = lval_len(args);
     for (size_t a = 0; a < len; a++) {
@@ -879,7 +853,7 @@ int lbi_func_load(struct lenv* env, const struct lval* args, struct lval* acc) {
 int lbi_func_error(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
     /* Retrieve arg 1: error string. */
-    struct lval* errv = lval_alloc();
+    struct lval* errv = lval_alloc_tmp();
     lval_index(args, 0, errv);
     /* Error. */
     struct lerr* err = lerr_throw(LERR_LISP_ERROR, "%s", lval_as_str(errv));
@@ -897,19 +871,22 @@ int lbi_func_debug_env(struct lenv* env, const struct lval* args, struct lval* a
 int lbi_func_debug_fun(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
     /* Retrieve arg 1: function. */
-    struct lval* func = lval_alloc();
+    struct lval* func = lval_alloc_tmp();
     lval_index(args, 0, func);
     const struct lfunc* func_ptr = lval_as_func(func);
     /* Debug. */
     lval_mut_qexpr(acc);
-    lval_push(acc, func_ptr->formals);
-    lval_push(acc, func_ptr->args);
     if (func_ptr->lisp_func) {
+        lval_push(acc, func_ptr->formals);
+        lval_push(acc, func_ptr->args);
         lval_push(acc, func_ptr->body);
     } else {
-        struct lval* builtin = lval_alloc();
+        /* The copy has formals, even if func_ptr is a lean builtin. */
+        struct lval* builtin = lval_alloc_tmp();
         lval_mut_func(builtin, func_ptr);
         struct lfunc* builtin_ptr = lval_as_func(builtin);
+        lval_push(acc, builtin_ptr->formals);
+        lval_push(acc, builtin_ptr->args);
         lval_clear(builtin_ptr->args);
         lval_mut_qexpr(builtin_ptr->args);
         lval_push(acc, builtin);
@@ -923,16 +900,16 @@ int lbi_func_debug_fun(struct lenv* env, const struct lval* args, struct lval* a
 int lbi_func_debug_val(struct lenv* env, const struct lval* args, struct lval* acc) {
     UNUSED(env);
     /* Retrieve arg 1: list of lval. */
-    struct lval* list = lval_alloc();
+    struct lval* list = lval_alloc_tmp();
     lval_index(args, 0, list);
     /* Debug. */
     lval_mut_qexpr(acc);
     size_t len = lval_len(list);
-    struct lval* sym = lval_alloc();
-    struct lval* result = lval_alloc();
-    struct lval* type_sym = lval_alloc();
-    struct lval* type_result = lval_alloc();
-    struct lval* wrap = lval_alloc();
+    struct lval* sym = lval_alloc_tmp();
+    struct lval* result = lval_alloc_tmp();
+    struct lval* type_sym = lval_alloc_tmp();
+    struct lval* type_result = lval_alloc_tmp();
+    struct lval* wrap = lval_alloc_tmp();
     for (size_t s = 0; s < len; s++) {
         lval_index(list, s, sym);
         lval_clear(result);
@@ -477,6 +477,33 @@ describe(builtin, {
             /* Expected. */
             lval_mut_num(expected, 10);
         });
+        it("folds + without allocating a list per element", {
+            struct lval* args = lval_alloc();
+            defer(lval_free(args));
+            lval_mut_qexpr(args);
+            push_func(args, &lbuiltin_op_add);
+            push_num(args, 0);
+            struct lval* qexpr = lval_alloc();
+            defer(lval_free(qexpr));
+            lval_mut_qexpr(qexpr);
+            for (long n = 1; n <= 10000; n++) {
+                push_num(qexpr, n);
+            }
+            lval_push(args, qexpr);
+            struct lval* got = lval_alloc();
+            defer(lval_free(got));
+            struct lenv* env = lenv_alloc();
+            defer(lenv_free(env));
+            lenv_default(env);
+            size_t handles = 0, data = 0;
+            lval_alloc_count(&handles, &data);
+            assert(0 == lfunc_exec(&lbuiltin_fold, env, args, got));
+            size_t handles_after = 0, data_after = 0;
+            lval_alloc_count(&handles_after, &data_after);
+            assert(data_after - data < 10);
+            long sum = 0;
+            assert(lval_as_num(got, &sum) && sum == 50005000);
+        });
     });
 
     subdesc(func_reverse, {
@@ -4,77 +4,79 @@
 #include <math.h>
 #include <stdlib.h>
 
-#include "vendor/mini-gmp/mini-gmp.h"
+#include "lgmp.h"
 
 #include "lval.h"
 #include "lenv.h"
 
 #define UNUSED(x) (void)(x)
 
-/* Conditions: overflow conditions for long. */
-static bool lbi_cond_num_add_overflow(const long a, const long b) {
-    return a >= LONG_MAX - b;
+/* Operators: long.
+ * They return false when the result overflows a long, the operation is then
+ * done on bignums. */
+static bool lbi_op_num_add(const long a, const long b, long* r) {
+    return !__builtin_add_overflow(a, b, r);
 }
 
-static bool lbi_cond_num_sub_overflow(const long a, const long b) {
-    return a <= LONG_MIN + b;
+static bool lbi_op_num_sub(const long a, const long b, long* r) {
+    return !__builtin_sub_overflow(a, b, r);
 }
 
-static bool lbi_cond_num_mul_overflow(const long a, const long b) {
-    return ((b > 0 && ((a > 0 && a > LONG_MAX / b) || (a < 0 && a < LONG_MIN / b))) ||
-            (b == -1 && a == -LONG_MAX) ||
-            (b < -1 && ((a < 0 && a < LONG_MAX / b) || (a > 0 && a > LONG_MIN / b))));
-}
-static bool lbi_cond_num_pow_overflow(const long a, const long b) {
-    long base = labs(a);
-    return (double)(b) > log2((double)LONG_MAX)/log2((double)base);
-}
-
-static bool lbi_cond_num_fac_overflow(const long a, const long b) {
-    UNUSED(a);
-    return b > 20;
-}
-
-/* Operators: long. */
-static long lbi_op_num_add(const long a, const long b) {
-    return a + b;
-}
-
-static long lbi_op_num_sub(const long a, const long b) {
-    return a - b;
-}
-
-static long lbi_op_num_mul(const long a, const long b) {
-    return a * b;
+static bool lbi_op_num_mul(const long a, const long b, long* r) {
+    return !__builtin_mul_overflow(a, b, r);
 }
 
-static long lbi_op_num_div(const long a, const long b) {
-    return a / b;
+static bool lbi_op_num_div(const long a, const long b, long* r) {
+    if (a == LONG_MIN && b == -1) {
+        return false;
+    }
+    *r = a / b;
+    return true;
 }
 
-static long lbi_op_num_mod(const long a, const long b) {
-    return a % b;
+static bool lbi_op_num_mod(const long a, const long b, long* r) {
+    if (a == LONG_MIN && b == -1) {
+        return false;
+    }
+    *r = a % b;
+    return true;
 }
 
-static long lbi_op_num_pow(const long a, const long b) {
-    long x = a;
-    for (int n = b; n > 1; n--) {
-        x *= a;
+static bool lbi_op_num_pow(const long a, const long b, long* r) {
+    if (b <= 1) {
+        *r = a;
+        return true;
+    }
+    /* Exponentiation by squaring. */
+    long x = 1;
+    long base = a;
+    for (long n = b; n > 0; n >>= 1) {
+        if ((n & 1) && __builtin_mul_overflow(x, base, &x)) {
+            return false;
+        }
+        if (n > 1 && __builtin_mul_overflow(base, base, &base)) {
+            return false;
+        }
     }
-    return x;
+    *r = x;
+    return true;
 }
 
-static long lbi_op_num_fac(const long a, const long b) {
+static bool lbi_op_num_fac(const long a, const long b, long* r) {
     UNUSED(a);
     if (b == 0) {
-        return 1;
+        *r = 1;
+        return true;
     }
     long fact = b;
     long n    = b;
     while (n > 2) {
-        fact *= --n;
+        if (__builtin_mul_overflow(fact, --n, &fact)) {
+            return false;
+        }
     }
-    return fact;
+    *r = fact;
+    return true;
 }
 
 /* Operators: double. */
@@ -160,14 +162,14 @@ static bool lbuiltin_cast(
 
 /** lbuiltin_operator does the automatic casting of args then execute op. */
 static int lbuiltin_operator(
-        /** op_* operates on basic types: dbl > bignum > num. */
-        long   (*op_num)(const long, const long),
+        /** op_* operates on basic types: dbl > bignum > num.
+         ** op_num fails when the result must be casted to bignum. */
+        bool   (*op_num)(const long, const long, long*),
         void   (*op_bignum)(mpz_t r, const mpz_t x, const mpz_t y),
         double (*op_dbl)(const double, const double),
-        /** cnd_overflow tells if an operation on nums must be casted to bignum. */
-        bool   (*cnd_overflow)(const long, const long),
         /* lbuitin arguments. */
         struct lenv* env, const struct lval* arg, struct lval* acc) {
+    UNUSED(env);
     switch (typeof_op(acc, arg)) {
     case LVAL_DBL:
         {
@@ -180,40 +182,22 @@ static int lbuiltin_operator(
         lval_mut_dbl(acc, op_dbl(a, b));
         return 0;
         }
-    case LVAL_BIGNUM:
-        {
-        mpz_t a, b;
-        mpz_init(a);
-        mpz_init(b);
-        lval_as_bignum(acc, a);
-        lval_as_bignum(arg, b);
-        mpz_t rbn;
-        mpz_init(rbn);
-        op_bignum(rbn, a, b);
-        mpz_clear(a);
-        mpz_clear(b);
-        lval_mut_bignum(acc, rbn);
-        mpz_clear(rbn);
-        return 0;
-        }
     case LVAL_NUM:
         {
-        long a, b;
+        long a, b, r;
         lval_as_num(acc, &a);
         lval_as_num(arg, &b);
-        if (cnd_overflow && cnd_overflow(a, b)) {
-            mpz_t bna;
-            mpz_init_set_si(bna, a);
-            lval_mut_bignum(acc, bna);
-            int s = lbuiltin_operator(
-                    op_num, op_bignum, op_dbl, cnd_overflow,
-                    env, arg, acc);
-            mpz_clear(bna);
-            return s;
+        if (op_num(a, b, &r)) {
+            lval_mut_num(acc, r);
+            return 0;
         }
-        lval_mut_num(acc, op_num(a, b));
-        return 0;
         }
+        /* Overflow: fallthrough to bignum. */
+    case LVAL_BIGNUM:
+        /* acc is updated in place when it holds its bignum alone,
+         * a result which fits in a long is demoted to num. */
+        lval_mut_bignum_op(acc, op_bignum, arg);
+        return 0;
     default: break;
     }
 
@@ -223,13 +207,47 @@ static int lbuiltin_operator(
     return -1;
 }
 
+/** lbuiltin_reduce is the bulk kernel of the operators: acc and the values
+ ** of argv are reduced on raw longs (or doubles), until a value of another
+ ** type or an overflow which are left to lbuiltin_operator. */
+static size_t lbuiltin_reduce(
+        bool   (*op_num)(const long, const long, long*),
+        double (*op_dbl)(const double, const double),
+        size_t argc, const struct lval* const* argv, size_t first, struct lval* acc) {
+    size_t c = first;
+    long a, b, r;
+    if (lval_as_num(acc, &a)) {
+        for (; c < argc; c++) {
+            if (!lval_as_num(argv[c], &b) || !op_num(a, b, &r)) {
+                break;
+            }
+            a = r;
+        }
+        lval_mut_num(acc, a);
+        return c;
+    }
+    if (op_dbl && lval_type(acc) == LVAL_DBL) {
+        double x, y;
+        lval_as_dbl(acc, &x);
+        for (; c < argc; c++) {
+            const struct lval* arg = argv[c];
+            if (lval_type(arg) != LVAL_DBL && lval_type(arg) != LVAL_NUM) {
+                break;
+            }
+            lval_as_dbl(arg, &y);
+            x = op_dbl(x, y);
+        }
+        lval_mut_dbl(acc, x);
+    }
+    return c;
+}
+
 /** Exported operators. */
 int lbi_op_add(struct lenv* env, const struct lval* arg, struct lval* acc) {
     return lbuiltin_operator(
             lbi_op_num_add,
             mpz_add,
             lbi_op_dbl_add,
-            lbi_cond_num_add_overflow,
             env, arg, acc);
 }
 
@@ -238,7 +256,6 @@ int lbi_op_sub(struct lenv* env, const struct lval* arg, struct lval* acc) {
             lbi_op_num_sub,
             mpz_sub,
             lbi_op_dbl_sub,
-            lbi_cond_num_sub_overflow,
             env, arg, acc);
 }
 
@@ -247,7 +264,6 @@ int lbi_op_mul(struct lenv* env, const struct lval* arg, struct lval* acc) {
             lbi_op_num_mul,
             mpz_mul,
             lbi_op_dbl_mul,
-            lbi_cond_num_mul_overflow,
             env, arg, acc);
 }
 
@@ -256,7 +272,6 @@ int lbi_op_div(struct lenv* env, const struct lval* arg, struct lval* acc) {
             lbi_op_num_div,
             mpz_fdiv_q,
             lbi_op_dbl_div,
-            NULL,
             env, arg, acc);
 }
 
@@ -265,7 +280,6 @@ int lbi_op_mod(struct lenv* env, const struct lval* arg, struct lval* acc) {
             lbi_op_num_mod,
             mpz_mod,
             NULL,
-            NULL,
             env, arg, acc);
 }
 
@@ -274,7 +288,6 @@ int lbi_op_fac(struct lenv* env, const struct lval* arg, struct lval* acc) {
             lbi_op_num_fac,
             lbi_op_bignum_fac,
             NULL,
-            lbi_cond_num_fac_overflow,
             env, arg, acc);
 }
 
@@ -283,21 +296,47 @@ int lbi_op_pow(struct lenv* env, const struct lval* arg, struct lval* acc) {
             lbi_op_num_pow,
             lbi_op_bignum_pow,
             lbi_op_dbl_pow,
-            lbi_cond_num_pow_overflow,
             env, arg, acc);
 }
 
+/** Exported kernels. */
+size_t lbi_reduce_add(size_t argc, const struct lval* const* argv,
+        size_t first, struct lval* acc) {
+    return lbuiltin_reduce(lbi_op_num_add, lbi_op_dbl_add, argc, argv, first, acc);
+}
+
+size_t lbi_reduce_sub(size_t argc, const struct lval* const* argv,
+        size_t first, struct lval* acc) {
+    return lbuiltin_reduce(lbi_op_num_sub, lbi_op_dbl_sub, argc, argv, first, acc);
+}
+
+size_t lbi_reduce_mul(size_t argc, const struct lval* const* argv,
+        size_t first, struct lval* acc) {
+    return lbuiltin_reduce(lbi_op_num_mul, lbi_op_dbl_mul, argc, argv, first, acc);
+}
+
+size_t lbi_reduce_div(size_t argc, const struct lval* const* argv,
+        size_t first, struct lval* acc) {
+    return lbuiltin_reduce(lbi_op_num_div, lbi_op_dbl_div, argc, argv, first, acc);
+}
+
+size_t lbi_reduce_mod(size_t argc, const struct lval* const* argv,
+        size_t first, struct lval* acc) {
+    return lbuiltin_reduce(lbi_op_num_mod, NULL, argc, argv, first, acc);
+}
+
 int lbi_op_eq(struct lenv* env, const struct lval* arg, struct lval* acc) {
     UNUSED(env);
-    /* Cast. */
-    struct lval* casted_acc = lval_alloc();
-    struct lval* casted_arg = lval_alloc();
-    lbuiltin_cast(acc, arg, casted_acc, casted_arg);
+    /* Cast: immediate values need no allocation, handles are on the stack. */
+    struct lval casted_acc, casted_arg;
+    lval_init(&casted_acc);
+    lval_init(&casted_arg);
+    lbuiltin_cast(acc, arg, &casted_acc, &casted_arg);
     /* Test. */
-    lval_mut_bool(acc, lval_are_equal(casted_acc, casted_arg));
+    lval_mut_bool(acc, lval_are_equal(&casted_acc, &casted_arg));
     /* Cleanup. */
-    lval_free(casted_acc);
-    lval_free(casted_arg);
+    lval_release(&casted_acc);
+    lval_release(&casted_arg);
     return 0;
 }
 
@@ -312,14 +351,15 @@ int lbi_op_neq(struct lenv* env, const struct lval* arg, struct lval* acc) {
 
 int lbuiltin_compare(const struct lval* x, const struct lval* y) {
     /* Cast. */
-    struct lval* casted_x = lval_alloc();
-    struct lval* casted_y = lval_alloc();
-    lbuiltin_cast(x, y, casted_x, casted_y);
+    struct lval casted_x, casted_y;
+    lval_init(&casted_x);
+    lval_init(&casted_y);
+    lbuiltin_cast(x, y, &casted_x, &casted_y);
     /* Test. */
-    int s = lval_compare(casted_x, casted_y);
+    int s = lval_compare(&casted_x, &casted_y);
     /* Cleanup. */
-    lval_free(casted_x);
-    lval_free(casted_y);
+    lval_release(&casted_x);
+    lval_release(&casted_y);
     return s;
 }
 
@@ -19,6 +19,22 @@ int lbi_op_fac(struct lenv* env, const struct lval* arg, struct lval* acc);
 /** lbi_op_pow is the ^ operator. */
 int lbi_op_pow(struct lenv* env, const struct lval* arg, struct lval* acc);
 
+/** lbi_reduce_add is the bulk kernel of the + operator (see lreduce). */
+size_t lbi_reduce_add(size_t argc, const struct lval* const* argv,
+        size_t first, struct lval* acc);
+/** lbi_reduce_sub is the bulk kernel of the - operator. */
+size_t lbi_reduce_sub(size_t argc, const struct lval* const* argv,
+        size_t first, struct lval* acc);
+/** lbi_reduce_mul is the bulk kernel of the * operator. */
+size_t lbi_reduce_mul(size_t argc, const struct lval* const* argv,
+        size_t first, struct lval* acc);
+/** lbi_reduce_div is the bulk kernel of the / operator. */
+size_t lbi_reduce_div(size_t argc, const struct lval* const* argv,
+        size_t first, struct lval* acc);
+/** lbi_reduce_mod is the bulk kernel of the % operator. */
+size_t lbi_reduce_mod(size_t argc, const struct lval* const* argv,
+        size_t first, struct lval* acc);
+
 /** lbi_op_eq is the == operator. */
 int lbi_op_eq(struct lenv* env, const struct lval* arg, struct lval* acc);
 /** lbi_op_neq is the != operator. */
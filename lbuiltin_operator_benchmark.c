@@ -0,0 +1,78 @@
+#include "lbuiltin_operator.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lgmp.h"
+#include "leval.h"
+#include "lval.h"
+#include "lenv.h"
+
+#define BENCHMARK_IMPL
+#include "benchmark.h"
+
+#ifndef RUNS
+#define RUNS 100000
+#endif
+
+#ifdef LGMP_SYSTEM
+#define BACKEND "gmp"
+#else
+#define BACKEND "mini-gmp"
+#endif
+
+/* Large factorial and power: multiplications of large bignums. */
+static const char* factorial_workload = "! 20000";
+static const char* power_workload = "^ 3 200000";
+/* Conversion to base 10 of a large factorial. */
+static const char* print_workload = "! 10000";
+
+static void benchmark_operator(const char* name, size_t runs, const char* workload) {
+    benchmark_display_banner(name, runs, workload);
+    struct lenv* env = lenv_alloc();
+    lenv_default(env);
+    struct lval* r = lval_alloc();
+    long long stt = benchmark_get_time_ns();
+    for (size_t run = 0; run < runs; run++) {
+        struct lerr* err = leval_from_string(env, workload, r);
+        assert(err == NULL);
+    }
+    long long end = benchmark_get_time_ns();
+    assert(lval_type(r) == LVAL_BIGNUM);
+    lval_free(r);
+    lenv_free(env);
+    benchmark_display_results(stt, end, runs);
+}
+
+static void benchmark_print(const char* name, size_t runs, const char* workload) {
+    benchmark_display_banner(name, runs, workload);
+    struct lenv* env = lenv_alloc();
+    lenv_default(env);
+    struct lval* r = lval_alloc();
+    struct lerr* err = leval_from_string(env, workload, r);
+    assert(err == NULL);
+    FILE* out = fopen("/dev/null", "w");
+    assert(out);
+    long long stt = benchmark_get_time_ns();
+    for (size_t run = 0; run < runs; run++) {
+        lval_print_to(r, out);
+    }
+    long long end = benchmark_get_time_ns();
+    fclose(out);
+    lval_free(r);
+    lenv_free(env);
+    benchmark_display_results(stt, end, runs);
+}
+
+int main(void)
+{
+    size_t runs = RUNS / 100000;
+    if (runs == 0) {
+        runs = 1;
+    }
+    benchmark_operator("bignum/" BACKEND "/factorial", runs, factorial_workload);
+    benchmark_operator("bignum/" BACKEND "/power", runs, power_workload);
+    benchmark_print("bignum/" BACKEND "/print", runs, print_workload);
+    return EXIT_SUCCESS;
+}
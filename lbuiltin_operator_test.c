@@ -39,6 +39,36 @@ describe(builtin, {
             push_bignum(args, 2);
             lval_mut_dbl(expected, 3.0);
         });
+        test_pass(&lbuiltin_op_add, "LVAL_NUM which overflows to LVAL_BIGNUM", {
+            push_num(args, LONG_MAX);
+            push_num(args, 1);
+            mut_bignum_add(expected, LONG_MAX, 1);
+        });
+        test_pass(&lbuiltin_op_add, "LVAL_NUM < 0 which overflows to LVAL_BIGNUM", {
+            push_num(args, LONG_MIN);
+            push_num(args, LONG_MIN);
+            mut_bignum_mul(expected, 1UL << 63, -2);
+        });
+        test_pass(&lbuiltin_op_add, "list of LVAL_NUM", {
+            for (long n = 1; n <= 100; n++) {
+                push_num(args, n);
+            }
+            lval_mut_num(expected, 5050);
+        });
+        test_pass(&lbuiltin_op_add, "list of LVAL_NUM which overflows then fits again", {
+            push_num(args, LONG_MAX);
+            push_num(args, 1);
+            push_num(args, -1);
+            push_num(args, -1);
+            lval_mut_num(expected, LONG_MAX - 1);
+        });
+        test_pass(&lbuiltin_op_add, "list of LVAL_NUM & LVAL_DBL casted to LVAL_DBL", {
+            push_num(args, 1);
+            push_num(args, 2);
+            push_dbl(args, 0.5);
+            push_num(args, 3);
+            lval_mut_dbl(expected, 6.5);
+        });
     });
 
     subdesc(op_sub, {
@@ -72,6 +102,11 @@ describe(builtin, {
             push_bignum(args, 1);
             lval_mut_dbl(expected, 2.0);
         });
+        test_pass(&lbuiltin_op_sub, "LVAL_BIGNUM demoted to LVAL_NUM", {
+            push_bignum(args, ULONG_MAX);
+            push_bignum(args, ULONG_MAX);
+            lval_mut_num(expected, 0);
+        });
     });
 
     subdesc(op_sub_unary, {
@@ -120,6 +155,17 @@ describe(builtin, {
             push_bignum(args, 20);
             lval_mut_dbl(expected, 200.0);
         });
+        test_pass(&lbuiltin_op_mul, "LVAL_NUM which overflows to LVAL_BIGNUM", {
+            push_num(args, LONG_MAX);
+            push_num(args, 2);
+            mut_bignum_mul(expected, LONG_MAX, 2);
+        });
+        test_pass(&lbuiltin_op_mul, "list of LVAL_NUM which overflows to LVAL_BIGNUM", {
+            push_num(args, 1L << 62);
+            push_num(args, 2);
+            push_num(args, 3);
+            mut_bignum_mul(expected, 1UL << 63, 3);
+        });
     });
 
     subdesc(op_div, {
@@ -153,6 +199,11 @@ describe(builtin, {
             push_bignum(args, 10);
             lval_mut_dbl(expected, 20.0);
         });
+        test_pass(&lbuiltin_op_div, "LVAL_NUM which overflows to LVAL_BIGNUM", {
+            push_num(args, LONG_MIN);
+            push_num(args, -1);
+            mut_bignum(expected, 1UL << 63);
+        });
         test_fail(&lbuiltin_op_div, "divisor of type LVAL_NUM = 0", {
             push_num(args, 200);
             push_num(args, 0);
@@ -262,6 +313,11 @@ describe(builtin, {
             push_bignum(args, 8);
             lval_mut_dbl(expected, 256.0);
         });
+        test_pass(&lbuiltin_op_pow, "LVAL_NUM which overflows to LVAL_BIGNUM", {
+            push_num(args, 2);
+            push_num(args, 64);
+            mut_bignum_add(expected, ULONG_MAX, 1);
+        });
     });
 
     subdesc(op_eq, {
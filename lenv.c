@@ -1,6 +1,7 @@
 #include "lenv.h"
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -9,74 +10,166 @@
 #include "lfunc.h"
 #include "lbuiltin.h"
 #include "leval.h"
-#include "generic/avl.h"
+#include "lsym.h"
+#include "generic/htable.h"
 
 struct env_payload {
-    char* key;
+    /** env_payload.key is an interned symbol (see lsym.h). */
+    const char* key;
     struct lval* val;
 };
 
-static struct env_payload* env_payload_alloc(const char* key, const struct lval* val) {
+/** lenv_copy_val copies val into dest. A constant, or any value when share
+ ** is set, is shared instead as it is copied on write (see lval_freeze). */
+static bool lenv_copy_val(struct lval* dest, const struct lval* val, bool share) {
+    if (share || lval_is_frozen(val)) {
+        return lval_dup(dest, val);
+    }
+    return lval_copy(dest, val);
+}
+
+static struct env_payload* env_payload_alloc(const char* key,
+        const struct lval* val, bool share) {
     struct env_payload* pl = calloc(1, sizeof(struct env_payload));
-    size_t len = strlen(key);
-    pl->key = malloc(len+1);
-    memcpy(pl->key, key, len);
-    pl->key[len] = '\0';
+    pl->key = key;
     pl->val = lval_alloc();
-    lval_copy(pl->val, val);
+    lenv_copy_val(pl->val, val, share);
     return pl;
 }
 
+/** env_payload_copy copies srcv, the copy shares the data of its value. */
 static void* env_payload_copy(const void* srcv) {
     struct env_payload* src = (struct env_payload*)srcv;
-    struct env_payload* dest = env_payload_alloc(src->key, src->val);
+    struct env_payload* dest = calloc(1, sizeof(struct env_payload));
+    dest->key = src->key;
+    dest->val = lval_alloc();
+    lval_dup(dest->val, src->val);
     return (void*)dest;
 }
 
 static void env_payload_free(void* datav) {
     struct env_payload* data = (struct env_payload*)datav;
-    if (data->key) {
-        free(data->key);
-    }
     if (data->val) {
         lval_free(data->val);
     }
     free(data);
 }
 
-static int env_payload_cmp(const void* leftv, const void* rightv) {
-    struct env_payload* left = (struct env_payload*)leftv;
-    struct env_payload* right = (struct env_payload*)rightv;
-    return strcmp(left->key, right->key);
-}
-
 static const char* env_payload_key(const void* datav) {
     struct env_payload* data = (struct env_payload*)datav;
     return data->key;
 }
 
+/** lenv_table is a hash table of bindings shared by the copies of an env.
+ ** It is duplicated by the first env mutating it while it is shared
+ ** (copy on write), so copying an env is O(1). */
+struct lenv_table {
+    /** lenv_table.refc is the number of env sharing the table. */
+    size_t refc;
+    struct htable* ht;
+    /** lenv_table.local tells if the symbols of the table are counted as
+     ** bound locally (see lsym_set_local): a local env uses the table.
+     ** They are uncounted when the table is freed. */
+    bool local;
+};
+
+/** lenv_table_count counts (or uncounts) the symbols of table as bound locally. */
+static void lenv_table_count(const struct lenv_table* table, bool local) {
+    size_t len = 0;
+    const char** keys = ht_keys(table->ht, &len);
+    for (size_t k = 0; k < len; k++) {
+        if (local) {
+            lsym_set_local(keys[k]);
+        } else {
+            lsym_unset_local(keys[k]);
+        }
+    }
+    free(keys);
+}
+
+static void lenv_table_release(struct lenv_table* table) {
+    if (!table || --table->refc > 0) {
+        return;
+    }
+    if (table->local) {
+        lenv_table_count(table, false);
+    }
+    ht_free(table->ht, env_payload_free);
+    free(table);
+}
+
 /** lenv associates a symbol descriptor with a string. */
 struct lenv {
     /** lenv.par is the parent environment. */
     struct lenv* par;
     /** lenv.len is the number of symbol in this env (not its parent). */
     size_t len;
-    /** lenv.tree is the AVL tree containing defined symbols. */
-    struct avl_node* tree;
+    /** lenv.table is the hash table containing defined symbols.
+     ** It is allocated on first insertion and may be shared by copies. */
+    struct lenv_table* table;
+    /** lenv.slotc is the number of slots of a call frame (see lenv_alloc_frame).
+     ** Slots are allocated with env; they are looked up before table. */
+    size_t slotc;
+    /** lenv.syms are the interned symbols bound by the slots. */
+    const char** syms;
+    /** lenv.slots are the values bound by the slots. */
+    struct lval* slots;
+    /** lenv.version changes each time a symbol is bound in env.
+     ** Versions are never reused, even by different env (see lenv_cache). */
+    uint64_t version;
 };
 
+/** lenv_versions is the last version given to an env. */
+static uint64_t lenv_versions = 0;
+
+/** lenv_touch gives a new version to env. */
+static inline void lenv_touch(struct lenv* env) {
+    env->version = ++lenv_versions;
+}
+
+/** lenv_localize counts the symbols of the table of env as bound locally
+ ** once env is chained to a parent. The symbols of the slots are counted
+ ** by lenv_alloc_frame. */
+static void lenv_localize(struct lenv* env) {
+    if (!env->par || !env->table || env->table->local) {
+        return;
+    }
+    lenv_table_count(env->table, true);
+    env->table->local = true;
+}
+
 struct lenv* lenv_alloc(void) {
     struct lenv* env = calloc(1, sizeof(struct lenv));
     env->par = NULL;
     env->len = 0;
-    env->tree = NULL;
+    env->table = NULL;
+    lenv_touch(env);
+    return env;
+}
+
+struct lenv* lenv_alloc_frame(const char* const* syms, size_t symc) {
+    /* The slots and their symbols follow the env in the same block. */
+    struct lenv* env = calloc(1, sizeof(struct lenv)
+            + symc * (sizeof(struct lval) + sizeof(const char*)));
+    env->slotc = symc;
+    env->len = symc;
+    env->slots = (struct lval*)(env + 1);
+    env->syms = (const char**)(env->slots + symc);
+    for (size_t s = 0; s < symc; s++) {
+        env->syms[s] = syms[s];
+        lval_init(&env->slots[s]);
+        lsym_set_local(syms[s]);
+    }
+    lenv_touch(env);
     return env;
 }
 
+/** lenv_clear clears the table of env, slots are kept. */
 static void lenv_clear(struct lenv* env) {
-    env->len = 0;
-    avl_free(env->tree, env_payload_free);
-    env->tree = NULL;
+    env->len = env->slotc;
+    lenv_table_release(env->table);
+    env->table = NULL;
+    lenv_touch(env);
 }
 
 void lenv_free(struct lenv* env) {
@@ -84,20 +177,78 @@ void lenv_free(struct lenv* env) {
         return;
     }
     lenv_clear(env);
+    for (size_t s = 0; s < env->slotc; s++) {
+        lsym_unset_local(env->syms[s]);
+        lval_release(&env->slots[s]);
+    }
     free(env);
 }
 
+static bool lenv_local_put(struct lenv* env,
+        const char* symbol, uint64_t hash, const struct lval* val, bool share);
+
 bool lenv_copy(struct lenv* dest, const struct lenv* src) {
     if (!dest || !src) {
         return false;
     }
     lenv_clear(dest);
     dest->par = src->par;
-    dest->len = src->len;
-    dest->tree = avl_duplicate(src->tree, env_payload_copy);
+    dest->len += src->len - src->slotc;
+    dest->table = src->table;
+    if (dest->table) {
+        dest->table->refc++;
+    }
+    for (size_t s = 0; s < src->slotc; s++) {
+        lenv_local_put(dest, src->syms[s], lsym_hash(src->syms[s]), &src->slots[s], true);
+    }
+    lenv_localize(dest);
     return true;
 }
 
+/** lenv_ht returns the hash table of env or NULL. */
+static inline struct htable* lenv_ht(const struct lenv* env) {
+    return (env->table) ? env->table->ht : NULL;
+}
+
+/** lenv_own_ht returns the hash table of env, ready to be mutated. */
+static struct htable* lenv_own_ht(struct lenv* env) {
+    if (!env->table) {
+        env->table = calloc(1, sizeof(struct lenv_table));
+        env->table->refc = 1;
+        env->table->ht = ht_alloc(0);
+    } else if (env->table->refc > 1) {
+        struct lenv_table* table = calloc(1, sizeof(struct lenv_table));
+        table->refc = 1;
+        table->ht = ht_duplicate(env->table->ht, env_payload_copy, env_payload_key);
+        table->local = env->table->local;
+        if (table->local) {
+            lenv_table_count(table, true);
+        }
+        env->table->refc--;
+        env->table = table;
+    }
+    return env->table->ht;
+}
+
+/** lenv_keys returns the symbols bound in env (not its parents).
+ ** Caller is responsible for calling free on the returned array. */
+static const char** lenv_keys(const struct lenv* env, size_t* len) {
+    size_t tlen = 0;
+    const char** tkeys = ht_keys(lenv_ht(env), &tlen);
+    if (env->slotc == 0) {
+        *len = tlen;
+        return tkeys;
+    }
+    *len = env->slotc + tlen;
+    const char** keys = malloc(*len * sizeof(const char*));
+    memcpy(keys, env->syms, env->slotc * sizeof(const char*));
+    if (tkeys) {
+        memcpy(keys + env->slotc, tkeys, tlen * sizeof(const char*));
+        free(tkeys);
+    }
+    return keys;
+}
+
 #define CHECK(cond) if (!(cond)) return false;
 bool lenv_are_equal(const struct lenv* left, const struct lenv* right) {
     if (left == right) {
@@ -113,7 +264,7 @@ bool lenv_are_equal(const struct lenv* left, const struct lenv* right) {
     struct lval* sym = lval_alloc();
     do {
         size_t len = 0;
-        const char** syms = avl_keys(env->tree, env_payload_key, &len);
+        const char** syms = lenv_keys(env, &len);
         for (size_t k = 0; k < len; k++) {
             lval_mut_sym(sym, syms[k]);
             if (!lenv_lookup(right, sym, NULL)) {
@@ -144,7 +295,7 @@ bool lenv_as_list(const struct lenv* env, struct lval* dest) {
     lval_mut_qexpr(dest);
     /* Given env. */
     size_t len = 0;
-    const char** syms = avl_keys(env->tree, env_payload_key, &len);
+    const char** syms = lenv_keys(env, &len);
     if (syms) {
         struct lval* key = lval_alloc();
         for (size_t k = 0; k < len; k++) {
@@ -176,7 +327,7 @@ void lenv_print_to(const struct lenv* env, FILE* out) {
     size_t wrap = 80;
     while (env) {
         size_t len = 0;
-        const char** syms = avl_keys(env->tree, env_payload_key, &len);
+        const char** syms = lenv_keys(env, &len);
         size_t width = 0;
         indent(indent, width, out);
         width += fprintf(out, "lenv(%ld){", len);
@@ -208,6 +359,49 @@ bool lenv_set_parent(struct lenv* env, struct lenv* par) {
         return false;
     }
     env->par = par;
+    lenv_localize(env);
+    return true;
+}
+
+/** lenv_local_find returns the value bound to symbol in env or NULL. */
+static struct lval* lenv_local_find(const struct lenv* env,
+        const char* symbol, uint64_t hash) {
+    /* The last slot wins when a symbol is bound twice, like lenv_put. */
+    for (size_t s = env->slotc; s-- > 0;) {
+        if (env->syms[s] == symbol) {
+            return &env->slots[s];
+        }
+    }
+    const struct env_payload* payload = ht_lookup(lenv_ht(env), symbol, hash);
+    return (payload) ? payload->val : NULL;
+}
+
+/** lenv_local_put binds a copy of val to symbol in env.
+ ** share tells if the data of val is shared instead (see lenv_copy_val). */
+static bool lenv_local_put(struct lenv* env,
+        const char* symbol, uint64_t hash, const struct lval* val, bool share) {
+    for (size_t s = env->slotc; s-- > 0;) {
+        if (env->syms[s] == symbol) {
+            return lenv_copy_val(&env->slots[s], val, share);
+        }
+    }
+    struct htable* ht = lenv_own_ht(env);
+    lenv_localize(env);
+    lenv_touch(env);
+    /* Insert into hash table. */
+    bool insertion = false;
+    struct env_payload* payload = env_payload_alloc(symbol, val, share);
+    if (!ht_insert(ht, payload->key, hash,
+                payload, env_payload_free, &insertion)) {
+        env_payload_free(payload);
+        return false;
+    }
+    if (insertion) {
+        env->len++;
+        if (env->table->local) {
+            lsym_set_local(symbol);
+        }
+    }
     return true;
 }
 
@@ -219,15 +413,34 @@ static bool lenv_local_lookup(const struct lenv* env,
         lval_mut_err_ptr(result, err);
         return false;
     }
-    struct env_payload symbolpl = {.key= (char*)symbol};
-    const struct env_payload* payload = avl_lookup(env->tree, env_payload_cmp, &symbolpl);
-    /* Symbol found. */
-    if (payload) {
-        lval_copy(result, payload->val);
-        /* Don't return lval_copy return value because result can be NULL,
-         * thus lval_copy fails. */
-        return true;
+    return lenv_local_find(env, symbol, lsym_hash(symbol)) != NULL;
+}
+
+bool lenv_lookup(const struct lenv* env,
+        const struct lval* sym, struct lval* result) {
+    if (!env) {
+        return false;
+    }
+    const char* symbol = lval_as_sym(sym);
+    if (!symbol) {
+        struct lerr* err = lerr_throw(LERR_BAD_SYMBOL, "lookup for nil");
+        if (!lval_mut_err_ptr(result, err)) {
+            lerr_free(err);
+        }
+        return false;
     }
+    /* The hash is computed once for the whole parent chain. */
+    uint64_t hash = lsym_hash(symbol);
+    do {
+        const struct lval* val = lenv_local_find(env, symbol, hash);
+        /* Symbol found: result shares the bound data (copy on write). */
+        if (val) {
+            lval_dup(result, val);
+            /* Don't return lval_dup return value because result can be NULL,
+             * thus lval_dup fails. */
+            return true;
+        }
+    } while ((env = env->par));
     /* Fail. */
     if (result) {
         struct lerr* err = lerr_throw(LERR_BAD_SYMBOL,
@@ -239,13 +452,31 @@ static bool lenv_local_lookup(const struct lenv* env,
     return false;
 }
 
-bool lenv_lookup(const struct lenv* env,
-        const struct lval* sym, struct lval* result) {
-    if (!env) {
+const struct lenv* lenv_root(const struct lenv* env) {
+    while (env && env->par) {
+        env = env->par;
+    }
+    return env;
+}
+
+bool lenv_lookup_cached(const struct lenv* env, const struct lenv* root,
+        const struct lval* sym, struct lenv_cache* cache, struct lval* result) {
+    const char* symbol = lval_as_sym(sym);
+    if (root && root == cache->root && root->version == cache->version
+            && !lsym_is_local(symbol)) {
+        lval_dup(result, cache->value);
+        return true;
+    }
+    if (!lenv_lookup(env, sym, result)) {
         return false;
     }
-    return lenv_local_lookup(env, sym, result)
-        || lenv_lookup(env->par, sym, result);
+    /* A symbol not bound locally is bound in root. */
+    if (!lsym_is_local(symbol)) {
+        cache->value = lenv_local_find(root, symbol, lsym_hash(symbol));
+        cache->root = (cache->value) ? root : NULL;
+        cache->version = root->version;
+    }
+    return true;
 }
 
 bool lenv_put(struct lenv* env,
@@ -257,15 +488,62 @@ bool lenv_put(struct lenv* env,
     if (!symbol) {
         return false;
     }
-    /* Insert into AVL. */
-    bool insertion = false;
-    struct env_payload* payload = env_payload_alloc(symbol, val);
-    struct avl_node* node = avl_alloc(payload);
-    env->tree = avl_insert(env->tree, node, env_payload_cmp, env_payload_free, &insertion);
-    if (insertion) {
-        env->len++;
+    return lenv_local_put(env, symbol, lsym_hash(symbol), val, false);
+}
+
+bool lenv_bind(struct lenv* env, size_t slot, const struct lval* val) {
+    if (!env || slot >= env->slotc) {
+        return false;
+    }
+    return lval_dup(&env->slots[slot], val);
+}
+
+const struct lval* lenv_slot(const struct lenv* env, size_t slot) {
+    if (!env || slot >= env->slotc) {
+        return NULL;
+    }
+    return &env->slots[slot];
+}
+
+void lenv_visit(const struct lenv* env,
+        void (*visit)(const struct lval* v, void* param), void* param) {
+    if (!env) {
+        return;
+    }
+    for (size_t s = 0; s < env->slotc; s++) {
+        visit(&env->slots[s], param);
+    }
+    if (!env->table || env->table->refc > 1) {
+        return;
+    }
+    size_t len = 0;
+    const char** keys = ht_keys(env->table->ht, &len);
+    for (size_t k = 0; k < len; k++) {
+        struct env_payload* pl = ht_lookup(env->table->ht, keys[k], lsym_hash(keys[k]));
+        visit(pl->val, param);
     }
-    return !avl_is_nil(env->tree);
+    free(keys);
+}
+
+bool lenv_inherit(struct lenv* env, const struct lenv* frame) {
+    if (!env || !frame) {
+        return false;
+    }
+    size_t len = 0;
+    const char** syms = lenv_keys(frame, &len);
+    for (size_t k = 0; k < len; k++) {
+        uint64_t hash = lsym_hash(syms[k]);
+        if (lenv_local_find(env, syms[k], hash)) {
+            continue;
+        }
+        /* The bindings of the frame are shared, not copied: a tail call
+         * costs no more than the symbols it inherits. */
+        lenv_local_put(env, syms[k], hash, lenv_local_find(frame, syms[k], hash), true);
+    }
+    free(syms);
+    env->par = frame->par;
+    lenv_localize(env);
+    return true;
 }
 
 /* Caution: call this function with statically allocated symbol string only. */
@@ -277,9 +555,7 @@ static bool lenv_put_builtin(struct lenv* env,
     struct lval* sym = lval_alloc();
     lval_mut_sym(sym, symbol);
     struct lval* fun = lval_alloc();
-    lval_mut_func(fun, func);
-    struct lfunc* func_ptr = lval_as_func(fun);
-    lfunc_set_symbol(func_ptr, symbol);
+    lval_mut_builtin(fun, func, symbol);
     bool s = lenv_put(env, sym, fun);
     lval_free(fun);
     lval_free(sym);
@@ -325,6 +601,21 @@ bool lenv_def(struct lenv* env,
     return lenv_put(env, sym, val);
 }
 
+bool lenv_set_dot(struct lenv* env, const struct lval* v) {
+    if (!env) {
+        return false;
+    }
+    while (env->par) { env = env->par; }
+    const char* symbol = lsym_intern(".");
+    uint64_t hash = lsym_hash(symbol);
+    struct lval* dot = lenv_local_find(env, symbol, hash);
+    /* A table shared with copies of env is copied on write by lenv_local_put. */
+    if (dot && (!env->table || env->table->refc == 1)) {
+        return lval_dup(dot, v);
+    }
+    return lenv_local_put(env, symbol, hash, v, false);
+}
+
 bool lenv_default(struct lenv* env) {
     if (!env) {
         return false;
@@ -2,6 +2,7 @@
 #define _H_LENV_
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "lval.h"
 
@@ -11,6 +12,10 @@ struct lenv;
 /** lenv_alloc creates a new lenv.
  ** Caller is responsible for calling lenv_free. */
 struct lenv* lenv_alloc(void);
+/** lenv_alloc_frame creates a new lenv for a function call: the symc
+ ** interned symbols syms are bound to nil in a flat array of slots.
+ ** Caller is responsible for calling lenv_free. */
+struct lenv* lenv_alloc_frame(const char* const* syms, size_t symc);
 /** lenv_free frees env.
  ** env must not be used afterwards.*/
 void lenv_free(struct lenv* env);
@@ -23,18 +28,55 @@ size_t lenv_len(const struct lenv* env);
 
 /** lenv_set_parent sets env parent to par. */
 bool lenv_set_parent(struct lenv* env, struct lenv* par);
-/** lenv_lookup returns the lval associated to sym. */
+/** lenv_inherit makes env take the place of frame in the chain of environments:
+ ** the symbols of frame not bound by env are copied into env, then
+ ** the parent of env becomes the parent of frame. */
+bool lenv_inherit(struct lenv* env, const struct lenv* frame);
+/** lenv_lookup returns the lval associated to sym.
+ ** result shares the bound data, which is copied on first mutation of result. */
 bool lenv_lookup(const struct lenv* env,
         const struct lval* sym, struct lval* result);
+/** lenv_cache is an inline cache of the binding of a symbol in the outermost
+ ** parent of an env (its root), see lenv_lookup_cached. */
+struct lenv_cache {
+    /** lenv_cache.root is the root in which the symbol was looked up. */
+    const struct lenv* root;
+    /** lenv_cache.version is the version of root when the symbol was looked up. */
+    uint64_t version;
+    /** lenv_cache.value is the value bound in root, it is not owned. */
+    const struct lval* value;
+};
+/** lenv_root returns the outermost parent of env (env itself if it has none). */
+const struct lenv* lenv_root(const struct lenv* env);
+/** lenv_lookup_cached does lenv_lookup through cache, root is lenv_root(env).
+ ** Only the symbols that are not bound in a local environment (an env
+ ** chained to a parent) are cached: they can only be bound in the root of
+ ** env. A symbol is cached again once its local bindings are all freed.
+ ** The cache is invalidated by any binding done in the root.
+ ** cache must be zeroed before first use. */
+bool lenv_lookup_cached(const struct lenv* env, const struct lenv* root,
+        const struct lval* sym, struct lenv_cache* cache, struct lval* result);
 /** lenv_put binds val to sym in env. */
 bool lenv_put(struct lenv* env,
         const struct lval* sym, const struct lval* val);
+/** lenv_bind binds val to the nth slot of env, sharing its data. */
+bool lenv_bind(struct lenv* env, size_t slot, const struct lval* val);
+/** lenv_slot returns the value bound to the nth slot of env or NULL. */
+const struct lval* lenv_slot(const struct lenv* env, size_t slot);
+/** lenv_visit calls visit on each value bound in env alone (not its parents).
+ ** The values of a table shared with copies of env are not visited. */
+void lenv_visit(const struct lenv* env,
+        void (*visit)(const struct lval* v, void* param), void* param);
 /** lenv_override tries to override sym in env and its parents. */
 bool lenv_override(struct lenv* env,
         const struct lval* sym, const struct lval* val);
 /** lenv_def binds val to sym in env outermost parent. */
 bool lenv_def(struct lenv* env,
         const struct lval* sym, const struct lval* val);
+/** lenv_set_dot binds v to the dot variable `.` (the last computed value)
+ ** in env outermost parent. Unlike lenv_def, the binding shares the data
+ ** of v: it is updated in place, without any allocation once bound. */
+bool lenv_set_dot(struct lenv* env, const struct lval* v);
 /** lenv_default fills env with default builtin functions. */
 bool lenv_default(struct lenv* env);
 
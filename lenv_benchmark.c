@@ -0,0 +1,74 @@
+#include "lenv.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lval.h"
+
+#define BENCHMARK_IMPL
+#include "benchmark.h"
+
+#ifndef RUNS
+#define RUNS 100000
+#endif
+
+#define LIST_LEN 100000
+
+/* Lookup of a symbol bound to a list of LIST_LEN elements. */
+static void benchmark_lookup_list(size_t runs) {
+    benchmark_display_banner("lenv/lookup", runs,
+            "lookup of a 100000 elements list binding");
+    struct lenv* env = lenv_alloc();
+    lenv_default(env);
+    struct lval* sym = lval_alloc();
+    lval_mut_sym(sym, "l");
+    struct lval* list = lval_alloc();
+    lval_mut_qexpr(list);
+    struct lval* num = lval_alloc();
+    for (long n = 0; n < LIST_LEN; n++) {
+        lval_mut_num(num, n);
+        lval_push(list, num);
+    }
+    lenv_put(env, sym, list);
+    struct lval* r = lval_alloc();
+    long long stt = benchmark_get_time_ns();
+    for (size_t run = 0; run < runs; run++) {
+        lenv_lookup(env, sym, r);
+    }
+    long long end = benchmark_get_time_ns();
+    assert(lval_len(r) == LIST_LEN);
+    lval_free(r);
+    lval_free(num);
+    lval_free(list);
+    lval_free(sym);
+    lenv_free(env);
+    benchmark_display_results(stt, end, runs);
+}
+
+/* Default environment: one binding per builtin. */
+static void benchmark_default(size_t runs) {
+    benchmark_display_banner("lenv/default", runs,
+            "allocation of a default env");
+    size_t handles = 0, data = 0;
+    lval_alloc_count(&handles, &data);
+    long long stt = benchmark_get_time_ns();
+    for (size_t run = 0; run < runs; run++) {
+        struct lenv* env = lenv_alloc();
+        lenv_default(env);
+        lenv_free(env);
+    }
+    long long end = benchmark_get_time_ns();
+    size_t handles_end = 0, data_end = 0;
+    lval_alloc_count(&handles_end, &data_end);
+    fprintf(stdout, "  Allocations: %zu handles, %zu ldata\n",
+            handles_end - handles, data_end - data);
+    benchmark_display_results(stt, end, runs);
+}
+
+int main(void)
+{
+    benchmark_lookup_list(RUNS);
+    benchmark_default(RUNS / 100);
+    return EXIT_SUCCESS;
+}
@@ -3,6 +3,7 @@
 #include "vendor/snow/snow/snow.h"
 
 #include "lval.h"
+#include "lsym.h"
 
 describe(lenv, {
     it("allocates an env and frees it", {
@@ -33,6 +34,31 @@ describe(lenv, {
             assert(lval_as_func(res) != NULL);
         });
 
+        it("shares `+` between default envs without allocation", {
+            struct lenv* left = lenv_alloc();
+            defer(lenv_free(left));
+            lenv_default(left);
+            struct lenv* right = lenv_alloc();
+            defer(lenv_free(right));
+            lenv_default(right);
+            struct lval* sym = lval_alloc();
+            defer(lval_free(sym));
+            lval_mut_sym(sym, "+");
+            struct lval* l = lval_alloc();
+            defer(lval_free(l));
+            struct lval* r = lval_alloc();
+            defer(lval_free(r));
+            size_t handles = 0, data = 0;
+            lval_alloc_count(&handles, &data);
+            assert(lenv_lookup(left, sym, l));
+            assert(lenv_lookup(right, sym, r));
+            size_t handles_after = 0, data_after = 0;
+            lval_alloc_count(&handles_after, &data_after);
+            assert(handles_after == handles && data_after == data);
+            assert(lval_is_frozen(l));
+            assert(lval_as_func(l) == lval_as_func(r));
+        });
+
         it("looks for an undefined symbol into the default env", {
             struct lenv* env = lenv_alloc();
             defer(lenv_free(env));
@@ -45,6 +71,30 @@ describe(lenv, {
             assert(!lenv_lookup(env, sym, res));
             assert(lval_type(res) == LVAL_ERR);
         });
+
+        it("looks for a list then mutates it without altering env", {
+            struct lenv* env = lenv_alloc();
+            defer(lenv_free(env));
+            struct lval* sym = lval_alloc();
+            defer(lval_free(sym));
+            lval_mut_sym(sym, "l");
+            struct lval* val = lval_alloc();
+            defer(lval_free(val));
+            struct lval* num = lval_alloc();
+            defer(lval_free(num));
+            lval_mut_num(num, 1);
+            lval_mut_qexpr(val);
+            lval_push(val, num);
+            assert(lenv_put(env, sym, val));
+            struct lval* res = lval_alloc();
+            defer(lval_free(res));
+            assert(lenv_lookup(env, sym, res));
+            assert(lval_are_equal(res, val));
+            lval_push(res, num);
+            assert(lval_len(res) == 2);
+            assert(lenv_lookup(env, sym, res));
+            assert(lval_len(res) == 1);
+        });
     });
 
     subdesc(put, {
@@ -86,6 +136,30 @@ describe(lenv, {
             assert(lenv_lookup(env, sym, got));
             assert(lval_are_equal(got, val));
         });
+
+        it("binds the slots of a frame then puts into them", {
+            const char* syms[] = {lsym_intern("x"), lsym_intern("y")};
+            struct lenv* env = lenv_alloc_frame(syms, 2);
+            defer(lenv_free(env));
+            assert(lenv_len(env) == 2);
+            struct lval* sym = lval_alloc();
+            defer(lval_free(sym));
+            struct lval* val = lval_alloc();
+            defer(lval_free(val));
+            struct lval* got = lval_alloc();
+            defer(lval_free(got));
+            long r = 0;
+            lval_mut_num(val, 100);
+            assert(lenv_bind(env, 1, val));
+            assert(!lenv_bind(env, 2, val));
+            lval_mut_sym(sym, "y");
+            assert(lenv_lookup(env, sym, got));
+            assert(lval_as_num(got, &r) && r == 100);
+            lval_mut_num(val, 200);
+            assert(lenv_put(env, sym, val));
+            assert(lval_as_num(lenv_slot(env, 1), &r) && r == 200);
+            assert(lenv_len(env) == 2);
+        });
     });
 
     subdesc(def, {
@@ -158,6 +232,34 @@ describe(lenv, {
             assert(lenv_lookup(dest, sym, got));
             assert(lval_are_equal(got, val));
         });
+        it("copies src into dest then puts into dest without altering src", {
+            struct lenv* src = lenv_alloc();
+            defer(lenv_free(src));
+            struct lval* sym = lval_alloc();
+            defer(lval_free(sym));
+            lval_mut_sym(sym, "x");
+            struct lval* val = lval_alloc();
+            defer(lval_free(val));
+            lval_mut_num(val, 100);
+            assert(lenv_put(src, sym, val));
+            struct lenv* dest = lenv_alloc();
+            defer(lenv_free(dest));
+            assert(lenv_copy(dest, src));
+            lval_mut_num(val, 200);
+            assert(lenv_put(dest, sym, val));
+            lval_mut_sym(sym, "y");
+            assert(lenv_put(dest, sym, val));
+            assert(lenv_len(src) == 1);
+            assert(lenv_len(dest) == 2);
+            struct lval* got = lval_alloc();
+            defer(lval_free(got));
+            long r = 0;
+            lval_mut_sym(sym, "x");
+            assert(lenv_lookup(src, sym, got));
+            assert(lval_as_num(got, &r) && r == 100);
+            assert(lenv_lookup(dest, sym, got));
+            assert(lval_as_num(got, &r) && r == 200);
+        });
     });
 
     subdesc(are_equal, {
@@ -304,6 +406,102 @@ describe(lenv, {
             assert(lval_type(got) == LVAL_NUM);
             assert(lval_as_num(got, &r) && r == 100);
         });
+        it("inherits child into a callee; lookup for locals in callee", {
+            set_parent_init();
+            long r;
+            struct lenv* callee = lenv_alloc();
+            defer(lenv_free(callee));
+            assert(lenv_set_parent(callee, child));
+            /* Define. */
+            lval_mut_sym(sym, "x");
+            lval_mut_num(val, 100);
+            assert(lenv_put(child, sym, val));
+            lval_mut_sym(sym, "y");
+            lval_mut_num(val, 200);
+            assert(lenv_put(child, sym, val));
+            lval_mut_sym(sym, "x");
+            lval_mut_num(val, 300);
+            assert(lenv_put(callee, sym, val));
+            assert(lenv_inherit(callee, child));
+            /* Lookups */
+            lval_mut_sym(sym, "x"); r = 0;
+            assert(lenv_lookup(callee, sym, got));
+            assert(lval_as_num(got, &r) && r == 300);
+            lval_mut_sym(sym, "y"); r = 0;
+            assert(lenv_lookup(callee, sym, got));
+            assert(lval_as_num(got, &r) && r == 200);
+            /* child is not in the chain of callee anymore. */
+            lval_mut_sym(sym, "z");
+            lval_mut_num(val, 400);
+            assert(lenv_put(child, sym, val));
+            assert(!lenv_lookup(callee, sym, got));
+        });
+        it("inherits a list into a callee without copying it", {
+            set_parent_init();
+            struct lenv* callee = lenv_alloc();
+            defer(lenv_free(callee));
+            assert(lenv_set_parent(callee, child));
+            lval_mut_qexpr(val);
+            struct lval* x = lval_alloc();
+            defer(lval_free(x));
+            for (long n = 0; n < 1000; n++) {
+                lval_mut_num(x, n);
+                lval_push(val, x);
+            }
+            lval_mut_sym(sym, "xs");
+            assert(lenv_put(child, sym, val));
+            size_t handles = 0, data = 0;
+            lval_alloc_count(&handles, &data);
+            assert(lenv_inherit(callee, child));
+            size_t handles_after = 0, data_after = 0;
+            lval_alloc_count(&handles_after, &data_after);
+            assert(data_after == data);
+            /* The list is copied on write. */
+            assert(lenv_lookup(callee, sym, got));
+            lval_mut_num(x, 1000);
+            lval_push(got, x);
+            assert(lenv_lookup(child, sym, got));
+            assert(lval_len(got) == 1000);
+        });
+    });
+
+    subdesc(lookup_cached, {
+        it("caches a global binding again once its local bindings are freed", {
+            set_parent_init();
+            long r;
+            struct lenv_cache cache = {0};
+            const struct lenv* root = lenv_root(child);
+            assert(root == parent);
+            lval_mut_sym(sym, "min");
+            lval_mut_num(val, 100);
+            assert(lenv_def(parent, sym, val));
+            assert(lenv_lookup_cached(child, root, sym, &cache, got));
+            assert(lval_as_num(got, &r) && r == 100);
+            assert(cache.root == parent);
+            /* Bound in a frame: not cached while the frame lives. */
+            const char* syms[] = {lsym_intern("min")};
+            struct lenv* frame = lenv_alloc_frame(syms, 1);
+            assert(lenv_set_parent(frame, child));
+            lval_mut_num(val, 200);
+            assert(lenv_bind(frame, 0, val));
+            assert(lsym_is_local(syms[0]));
+            cache = (struct lenv_cache){0};
+            assert(lenv_lookup_cached(frame, root, sym, &cache, got));
+            assert(lval_as_num(got, &r) && r == 200);
+            assert(cache.root == NULL);
+            lenv_free(frame);
+            /* Bound in the table of a local env. */
+            struct lenv* local = lenv_alloc();
+            assert(lenv_set_parent(local, child));
+            assert(lenv_put(local, sym, val));
+            assert(lsym_is_local(syms[0]));
+            lenv_free(local);
+            /* No local binding left: cached again. */
+            assert(!lsym_is_local(syms[0]));
+            assert(lenv_lookup_cached(child, root, sym, &cache, got));
+            assert(lval_as_num(got, &r) && r == 100);
+            assert(cache.root == parent);
+        });
     });
 });
 
@@ -13,44 +13,162 @@
 #include "lenv.h"
 #include "lfunc.h"
 #include "lbuiltin.h"
+#include "lvm.h"
+
+static enum leval_engine leval_current_engine = LEVAL_TREE;
+
+void leval_set_engine(enum leval_engine engine) {
+    leval_current_engine = engine;
+}
+
+enum leval_engine leval_engine(void) {
+    return leval_current_engine;
+}
+
+static bool leval_compile_all = false;
+
+void leval_set_compile_all(bool all) {
+    leval_compile_all = all;
+}
 
 static bool leval_lval(struct lenv* env, const struct lval* v, struct lval* r, bool exec);
 
-static bool leval_expr(
-        struct lenv* env, const struct lval* func, const struct lval* args, struct lval* r) {
+/** leval_tail is a call in tail position of the body of a lisp function,
+ ** whose body is left to leval_exec_body. */
+struct leval_tail {
+    /** leval_tail.local is the environment of the body. */
+    struct lenv* local;
+    /** leval_tail.func holds the function called. */
+    struct lval* func;
+    /** leval_tail.last is the ast of the last relocation of an error of the
+     ** body by the calls eliminated, leval_tail.located the ast of the last
+     ** location, may be NULL (see lvm_pending). */
+    const struct last* last;
+    const struct last* located;
+};
+
+/** leval_locate relocates the error r to the ast of v. */
+static void leval_locate(struct lval* r, const struct lval* v) {
+    r->ast = (v) ? v->ast : 0;
+    struct lerr* cause = lerr_cause(lval_as_err(r));
+    const struct last* ast = lval_ast(r);
+    if (ast) {
+        lerr_set_location(cause, ast->line, ast->col);
+    }
+}
+
+/** leval_expr executes func on args.
+ ** If tail is not NULL, the body of a lisp function is not executed but
+ ** described into tail. */
+static bool leval_expr(struct lenv* env, const struct lval* func,
+        const struct lval* args, struct lval* r, struct leval_tail* tail) {
     /* Execute expression. */
-    int err = lfunc_exec(lval_as_func(func), env, args, r);
+    const struct lfunc* fun = lval_as_func(func);
+    int err = 0;
+    if (tail && fun->lisp_func) {
+        err = lfunc_enter_exec(fun, env, args, r, &tail->local);
+    } else {
+        err = lfunc_exec(fun, env, args, r);
+    }
+    /* Tail call: a failure of the body is relocated to the first argument. */
+    if (tail && tail->local) {
+        lval_dup(tail->func, func);
+        tail->last = (lval_len(args) > 0) ? lval_ast(lval_index_ptr(args, 0)) : NULL;
+        tail->located = tail->last;
+        return true;
+    }
     /* Error handling. */
     if (err != 0) {
         if (err == -1) {
-            r->ast = func->ast;
+            leval_locate(r, func);
         } else {
             /* Set r->ast to the node returning an error. */
-            struct lval* child = lval_alloc();
-            lval_index(args, err-1, child);
-            r->ast = child->ast;
-            lval_free(child);
-        }
-        struct lerr* cause = lerr_cause(lval_as_err(r));
-        if (r->ast) {
-            lerr_set_location(cause, r->ast->line, r->ast->col);
+            leval_locate(r, lval_index_ptr(args, err-1));
         }
     }
     return lval_type(r) != LVAL_ERR;
 }
 
-/** leval_set_dot sets the special dot variable (last computed value). */
-static void leval_set_dot(struct lenv* env, const struct lval* r) {
-    struct lval* dot = lval_alloc();
-    lval_mut_sym(dot, ".");
-    lenv_def(env, dot, r);
-    lval_free(dot);
+/** leval_dot is the value of the dot variable (last computed value) for both
+ ** engines, bound into the environment only when it is looked up or when
+ ** leval_from_string ends. */
+static struct {
+    struct lval value;
+    bool dirty;
+} leval_dot;
+
+void leval_set_dot(const struct lval* r) {
+    if (!leval_dot.dirty) {
+        lval_init(&leval_dot.value);
+        leval_dot.dirty = true;
+    }
+    lval_dup(&leval_dot.value, r);
+}
+
+void leval_flush_dot(struct lenv* env) {
+    if (!leval_dot.dirty) {
+        return;
+    }
+    lenv_set_dot(env, &leval_dot.value);
+    lval_release(&leval_dot.value);
+    leval_dot.dirty = false;
+}
+
+/** leval_is_dot tells if the symbol v is the dot variable. */
+static inline bool leval_is_dot(const struct lval* v) {
+    const char* sym = lval_as_sym(v);
+    return sym && sym[0] == '.' && sym[1] == '\0';
+}
+
+static bool leval_sexpr(struct lenv* env,
+        const struct lval* v, struct lval* r, bool exec, struct leval_tail* tail);
+
+/** leval_tail_if evaluates the call of the builtin `if` on args in tail
+ ** position: the branch is evaluated like lbi_func_if would, its call in
+ ** tail position is described into tail. It fails if the builtin itself
+ ** must be called. */
+static bool leval_tail_if(struct lenv* env, const struct lval* func,
+        const struct lval* args, struct lval* r, struct leval_tail* tail, bool* s) {
+    const struct lfunc* fun = lval_as_func(func);
+    if (fun->func != lbuiltin_if.func || fun->lisp_func || lval_len(fun->args) > 0
+            || lval_len(args) != 3) {
+        return false;
+    }
+    const struct lval* cond = lval_index_ptr(args, 0);
+    if (lval_type(cond) != LVAL_BOOL) {
+        return false;
+    }
+    const struct lval* branch = lval_index_ptr(args, (lval_as_bool(cond)) ? 1 : 2);
+    if (lval_type(branch) != LVAL_QEXPR) {
+        return false;
+    }
+    struct lval* sexpr = lval_alloc_tmp();
+    lval_copy(sexpr, branch);
+    lval_mut_sexpr(sexpr);
+    bool evaluated = leval_sexpr(env, sexpr, r, true, tail);
+    lval_free(sexpr);
+    /* The call of `if` relocates the errors to the condition. */
+    if (tail->local) {
+        tail->last = lval_ast(cond);
+        if (tail->last) {
+            tail->located = tail->last;
+        }
+        *s = true;
+        return true;
+    }
+    if (!evaluated) {
+        leval_locate(r, cond);
+    }
+    *s = lval_type(r) != LVAL_ERR;
+    return true;
 }
 
 /** leval_sexpr evaluates an S-Expression.
- ** exec tells if the S-Expression should be evaluated like an expression. */
+ ** exec tells if the S-Expression should be evaluated like an expression.
+ ** If tail is not NULL, v is in tail position of the body of a lisp function
+ ** (see leval_expr). */
 static bool leval_sexpr(struct lenv* env,
-        const struct lval* v, struct lval* r, bool exec) {
+        const struct lval* v, struct lval* r, bool exec, struct leval_tail* tail) {
     /* Empty sexpr. */
     size_t len = lval_len(v);
     if (len == 0) {
@@ -58,32 +176,32 @@ static bool leval_sexpr(struct lenv* env,
         return true;
     }
     /* Evaluates all children. */
-    struct lval* expr = lval_alloc();
+    struct lval* expr = lval_alloc_tmp();
     lval_mut_sexpr(expr);
     for (size_t c = 0; c < len; c++) {
-        struct lval* child = lval_alloc();
+        struct lval* child = lval_alloc_tmp();
         lval_index(v, c, child);
-        struct lval* x = lval_alloc();
+        struct lval* x = lval_alloc_tmp();
         if (!leval_lval(env, child, x, true)) {
-            lval_dup(r, x);
+            lval_move(r, x);
             lval_free(x);
             lval_free(child);
             lval_free(expr);
             struct lerr* cause = lerr_cause(lval_as_err(r));
-            if (r->ast) {
-                lerr_set_location(cause, r->ast->line, r->ast->col);
+            const struct last* ast = lval_ast(r);
+            if (ast) {
+                lerr_set_location(cause, ast->line, ast->col);
             }
             return false;
         }
-        lval_push(expr, x);
         /* Result of last S-Expression. */
         if (c == len-1) {
             /* r = last argument value */
             lval_mut_nil(r);
             lval_dup(r, x);
-            leval_set_dot(env, r);
+            leval_set_dot(r);
         }
-        lval_free(x);
+        lval_push_move(expr, x);
         lval_free(child);
     }
     if (!exec) {
@@ -96,8 +214,14 @@ static bool leval_sexpr(struct lenv* env,
     struct lval* args = expr; // aliasing for clarity.
     if (lval_type(child) == LVAL_FUNC) {
         lval_mut_nil(r);
-        s = leval_expr(env, child, args, r);
-        leval_set_dot(env, r);
+        if (!tail || !leval_tail_if(env, child, args, r, tail, &s)) {
+            s = leval_expr(env, child, args, r, tail);
+        }
+        /* A call eliminated sets the dot once its body returns. */
+        if (!tail || !tail->local) {
+            leval_set_dot(r);
+        }
+        lval_gc_safe_point();
     }
     lval_free(child);
     lval_free(expr);
@@ -116,12 +240,15 @@ static bool leval_lval(struct lenv* env, const struct lval* v, struct lval* r, b
     switch (lval_type(v)) {
     case LVAL_SYM:
         {
+        if (leval_is_dot(v)) {
+            leval_flush_dot(env);
+        }
         bool s = lenv_lookup(env, v, r);
         r->ast = v->ast;
         return s;
         }
     case LVAL_SEXPR:
-        return leval_sexpr(env, v, r, exec);
+        return leval_sexpr(env, v, r, exec, NULL);
     case LVAL_ERR:
         lval_dup(r, v);
         return false;
@@ -131,8 +258,78 @@ static bool leval_lval(struct lenv* env, const struct lval* v, struct lval* r, b
     }
 }
 
+/** leval_program evaluates v with the engine in use.
+ ** The virtual machine only compiles the programs whose code is executed more
+ ** than once (see lcode_pays_off), the lisp functions are still executed by
+ ** it whichever engine calls them (see leval_set_compile_all). */
+static bool leval_program(struct lenv* env, const struct lval* v, struct lval* r, bool exec) {
+    if (leval_current_engine == LEVAL_VM
+            && (leval_compile_all || lcode_pays_off(v, exec))) {
+        return lvm_eval(env, v, r, exec);
+    }
+    return leval_lval(env, v, r, exec);
+}
+
 bool leval(struct lenv* env, const struct lval* v, struct lval* r) {
-    return leval_lval(env, v, r, true);
+    return leval_program(env, v, r, true);
+}
+
+bool leval_exec_body(const struct lfunc* fun, struct lenv* env, struct lval* r) {
+    /* Environment and function called in tail position. */
+    struct lenv* owned_env = NULL;
+    struct lval* owned_func = NULL;
+    /* Relocation of the errors by the calls eliminated, the first one done
+     * being the last one described. */
+    bool pending = false;
+    const struct last* last = NULL;
+    const struct last* located = NULL;
+    bool s = true;
+    while (true) {
+        struct leval_tail tail = {.func = lval_alloc()};
+        s = leval_sexpr(env, fun->body, r, true, &tail);
+        if (!tail.local) {
+            lval_free(tail.func);
+            break;
+        }
+        if (!pending) {
+            pending = true;
+            last = tail.last;
+            located = tail.located;
+        } else if (!located) {
+            located = tail.located;
+        }
+        /* The callee replaces the current call. */
+        lenv_inherit(tail.local, env);
+        if (owned_env) {
+            lenv_free(owned_env);
+        }
+        env = owned_env = tail.local;
+        if (owned_func) {
+            lval_free(owned_func);
+        }
+        owned_func = tail.func;
+        fun = lval_as_func(owned_func);
+    }
+    if (pending && lval_type(r) == LVAL_ERR) {
+        lval_set_ast(r, located);
+        struct lerr* cause = lerr_cause(lval_as_err(r));
+        if (located) {
+            lerr_set_location(cause, located->line, located->col);
+        }
+        lval_set_ast(r, last);
+        s = false;
+    }
+    /* Result of the calls eliminated. */
+    if (pending) {
+        leval_set_dot(r);
+    }
+    if (owned_env) {
+        lenv_free(owned_env);
+    }
+    if (owned_func) {
+        lval_free(owned_func);
+    }
+    return s;
 }
 
 struct lerr* leval_from_string(struct lenv* env,
@@ -141,6 +338,8 @@ struct lerr* leval_from_string(struct lenv* env,
     struct last* ast = NULL;
     struct lval* program = NULL;
     struct lerr* error = NULL;
+    /* Scratch handles of the evaluation are released together. */
+    size_t mark = lval_arena_mark();
     do {
         /* Lex input. */
         tokens = lisp_lex_surround(input, &error);
@@ -164,17 +363,21 @@ struct lerr* leval_from_string(struct lenv* env,
             break;
         }
         /* Evaluate program. */
-        if (program && !leval_lval(env, program, r, false)) {
+        if (program && !leval_program(env, program, r, false)) {
             error = lerr_alloc();
             lerr_copy(error, lval_as_err(r));
             error = lerr_propagate(error, "eval error:");
             break;
         }
     } while (0); // Allow to break.
+    /* Bind the value of the last S-Expression. */
+    leval_flush_dot(env);
     /* Cleanup. */
     if (tokens)  llex_free(tokens);
     if (ast)     last_free(ast);
     if (program) lval_free(program);
+    lval_arena_release(mark);
+    lval_gc_safe_point();
     return error;
 }
 
@@ -6,6 +6,20 @@
 #include "lval.h"
 #include "lenv.h"
 #include "lerr.h"
+#include "lfunc.h"
+
+/** leval_engine tells how programs are evaluated. */
+enum leval_engine {
+    LEVAL_TREE = 0, /* Tree walking interpreter, the reference (default). */
+    LEVAL_VM,       /* Bytecode compiler and virtual machine (see lvm.h). */
+};
+/** leval_set_engine selects the engine used by subsequent evaluations. */
+void leval_set_engine(enum leval_engine engine);
+/** leval_engine returns the engine currently in use. */
+enum leval_engine leval_engine(void);
+/** leval_set_compile_all makes the virtual machine compile every program,
+ ** even those it would rather walk (see lcode_pays_off); used by the tests. */
+void leval_set_compile_all(bool all);
 
 /** lisp_eval_from_string evaluates input and prints result to stdout. */
 struct lerr* lisp_eval_from_string(struct lenv* env, const char* restrict input);
@@ -21,5 +35,13 @@ struct lerr* leval_from_file(struct lenv* env, FILE* input, struct lval* r);
  ** v    is the program to execute;
  ** r    is the result. */
 bool leval(struct lenv* env, const struct lval* v, struct lval* r);
+/** leval_exec_body executes the body of the lisp function fun in env.
+ ** Calls in tail position reuse the C stack of this call. */
+bool leval_exec_body(const struct lfunc* fun, struct lenv* env, struct lval* r);
+/** leval_set_dot sets the special dot variable (last computed value).
+ ** It is bound into the environment by leval_flush_dot. */
+void leval_set_dot(const struct lval* v);
+/** leval_flush_dot binds the dot variable into env. */
+void leval_flush_dot(struct lenv* env);
 
 #endif
@@ -0,0 +1,99 @@
+#include "leval.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lval.h"
+#include "lenv.h"
+
+#define BENCHMARK_IMPL
+#include "benchmark.h"
+
+#ifndef RUNS
+#define RUNS 100000
+#endif
+
+/* Runs of the workloads which take a while. */
+#define LONG_RUNS (RUNS / 100000 > 0 ? RUNS / 100000 : 1)
+
+/** leval_workload is a program run by both engines: definition is evaluated
+ ** once, then workload runs times, its last result must be expected. */
+struct leval_workload {
+    const char* name;
+    size_t      runs;
+    const char* definition;
+    const char* workload;
+    long        expected;
+};
+
+static const struct leval_workload workloads[] = {
+    /* Recursive function calls, each one going through `if`. */
+    {"", LONG_RUNS,
+        "fun {fib n} {if (< n 2) {n} {+ (fib (- n 1)) (fib (- n 2))}}",
+        "fib 20", 6765},
+    /* Lisp function applied to each element of a list by a builtin. */
+    {"/fold", LONG_RUNS,
+        "def {xs} (seq 1 100000)",
+        "fold (\\ {a x} {+ a x}) 0 xs", 5000050000},
+    /* Accumulator builtin applied to a large list of integers. */
+    {"/sum", LONG_RUNS,
+        "def {xs} (seq 1 100000)",
+        "curry + xs", 5000050000},
+    /* Integers going through bignums and back. */
+    {"/mixed", LONG_RUNS,
+        "def {xs} (seq 1 100000)",
+        "fold (\\ {a x} {+ a (- (* x 4611686018427387904) (* x 4611686018427387903))}) 0 xs",
+        5000050000},
+    /* Bignum accumulator. */
+    {"/factorial", LONG_RUNS,
+        "def {xs} (seq 1 5000)",
+        "fold / (fold * 1 xs) xs", 1},
+    /* Loop body full of literals. */
+    {"/literals", LONG_RUNS,
+        "def {xs} (seq 1 10000)",
+        "len (map (\\ {x} {list x 1 2.5 \"alpha\" \"beta\" {a b c} 42 \"gamma\"}) xs)",
+        10000},
+    /* REPL-style request on small values: dominated by scratch handles. */
+    {"/small", RUNS,
+        "def {x} 1",
+        "+ x (* 2 3)", 7},
+    /* Tail calls: the recursion is as deep as the count. */
+    {"/tail", 1,
+        "fun {count n} {if (== n 0) {0} {count (- n 1)}}",
+        "count 1000000", 0},
+};
+
+/** benchmark_workload runs w with engine, named after both. */
+static void benchmark_workload(enum leval_engine engine, const char* engine_name,
+        const struct leval_workload* w) {
+    char name[64];
+    snprintf(name, sizeof(name), "leval/%s%s", engine_name, w->name);
+    benchmark_display_banner(name, w->runs, w->workload);
+    leval_set_engine(engine);
+    struct lenv* env = lenv_alloc();
+    lenv_default(env);
+    struct lval* r = lval_alloc();
+    struct lerr* err = leval_from_string(env, w->definition, r);
+    assert(err == NULL);
+    long long stt = benchmark_get_time_ns();
+    for (size_t run = 0; run < w->runs; run++) {
+        err = leval_from_string(env, w->workload, r);
+        assert(err == NULL);
+    }
+    long long end = benchmark_get_time_ns();
+    long x = 0;
+    assert(lval_as_num(r, &x) && x == w->expected);
+    lval_free(r);
+    lenv_free(env);
+    benchmark_display_results(stt, end, w->runs);
+}
+
+int main(void)
+{
+    for (size_t i = 0; i < sizeof(workloads)/sizeof(workloads[0]); i++) {
+        benchmark_workload(LEVAL_TREE, "tree", &workloads[i]);
+        benchmark_workload(LEVAL_VM, "vm", &workloads[i]);
+    }
+    return EXIT_SUCCESS;
+}
@@ -3,15 +3,52 @@
 #include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
-#include "vendor/mini-gmp/mini-gmp.h"
+#include "lgmp.h"
 
 #include "lval.h"
 #include "lenv.h"
 
 #include "vendor/snow/snow/snow.h"
 
+/* Each test is run by both engines, the virtual machine compiling every
+ * program or not (see leval_set_compile_all). */
 #define test_pass(input, ouput, ...) \
-    it("passes: "input" => "ouput, { \
+    test_pass_with(LEVAL_TREE, false, "tree", input, ouput, __VA_ARGS__); \
+    test_pass_with(LEVAL_VM, false, "vm", input, ouput, __VA_ARGS__); \
+    test_pass_with(LEVAL_VM, true, "vm-all", input, ouput, __VA_ARGS__)
+
+#define test_pass_with(engine, all, name, input, ouput, ...) \
+    it("passes ("name"): "input" => "ouput, { \
+        leval_set_engine(engine); \
+        defer(leval_set_engine(LEVAL_TREE)); \
+        leval_set_compile_all(all); \
+        defer(leval_set_compile_all(false)); \
+        struct lval *expected = lval_alloc(); \
+        defer(lval_free(expected)); \
+        __VA_ARGS__ \
+        struct lval *result = lval_alloc(); \
+        defer(lval_free(result)); \
+        struct lenv* env = lenv_alloc(); \
+        defer(lenv_free(env)); \
+        lenv_default(env); \
+        struct lerr* err = leval_from_string(env, input, result); \
+        assert(err == NULL); \
+        defer(lerr_free(err)); \
+        assert(lval_are_equal(result, expected)); \
+    })
+
+/* The input is evaluated after before, in the same environment. */
+#define test_pass_after(before, input, ouput, ...) \
+    test_pass_after_with(LEVAL_TREE, false, "tree", before, input, ouput, __VA_ARGS__); \
+    test_pass_after_with(LEVAL_VM, false, "vm", before, input, ouput, __VA_ARGS__); \
+    test_pass_after_with(LEVAL_VM, true, "vm-all", before, input, ouput, __VA_ARGS__)
+
+#define test_pass_after_with(engine, all, name, before, input, ouput, ...) \
+    it("passes ("name"): "before" then "input" => "ouput, { \
+        leval_set_engine(engine); \
+        defer(leval_set_engine(LEVAL_TREE)); \
+        leval_set_compile_all(all); \
+        defer(leval_set_compile_all(false)); \
         struct lval *expected = lval_alloc(); \
         defer(lval_free(expected)); \
         __VA_ARGS__ \
@@ -20,6 +57,7 @@
         struct lenv* env = lenv_alloc(); \
         defer(lenv_free(env)); \
         lenv_default(env); \
+        lerr_free(leval_from_string(env, before, result)); \
         struct lerr* err = leval_from_string(env, input, result); \
         assert(err == NULL); \
         defer(lerr_free(err)); \
@@ -27,7 +65,16 @@
     })
 
 #define test_fail(input, err) \
-    it("fails: "input" => "#err, { \
+    test_fail_with(LEVAL_TREE, false, "tree", input, err); \
+    test_fail_with(LEVAL_VM, false, "vm", input, err); \
+    test_fail_with(LEVAL_VM, true, "vm-all", input, err)
+
+#define test_fail_with(engine, all, name, input, err) \
+    it("fails ("name"): "input" => "#err, { \
+        leval_set_engine(engine); \
+        defer(leval_set_engine(LEVAL_TREE)); \
+        leval_set_compile_all(all); \
+        defer(leval_set_compile_all(false)); \
         struct lval *expected = lval_alloc(); \
         defer(lval_free(expected)); \
         lval_mut_err_code(expected, err); \
@@ -42,6 +89,33 @@
         assert(lval_are_equal(result, expected)); \
     })
 
+/* The constants of many programs are freed with them. */
+#define test_consts_with(engine, all, name) \
+    it("frees the constants of the programs ("name")", { \
+        leval_set_engine(engine); \
+        defer(leval_set_engine(LEVAL_TREE)); \
+        leval_set_compile_all(all); \
+        defer(leval_set_compile_all(false)); \
+        struct lval *result = lval_alloc(); \
+        defer(lval_free(result)); \
+        struct lenv* env = lenv_alloc(); \
+        defer(lenv_free(env)); \
+        lenv_default(env); \
+        char input[128]; \
+        size_t count = 0; \
+        for (int i = 0; i < 1000; i++) { \
+            snprintf(input, sizeof(input), \
+                    "(len \"literal %d\") (len {%d {%d}}) 0", i, i, i+1); \
+            struct lerr* err = leval_from_string(env, input, result); \
+            assert(err == NULL); \
+            /* Symbols are kept from the first program on. */ \
+            if (i == 0) { \
+                count = lval_const_count(); \
+            } \
+        } \
+        assert(lval_const_count() == count); \
+    })
+
 #define push_num(args, num) \
     do { \
         struct lval* x = lval_alloc(); \
@@ -124,6 +198,31 @@ describe(lisp_eval, {
     test_pass("(^ 2 8)(+ . .)", "512", {
             lval_mut_num(expected, 512);
         });
+    /* Dot variable: last computed value, the last argument before a call. */
+    test_pass_after("(+ 1 2)", "(* . 2)", "6", {
+            lval_mut_num(expected, 6);
+        });
+    test_pass("(fun {f x} {.})(f 7)", "7", {
+            lval_mut_num(expected, 7);
+        });
+    test_pass("(fun {f x} {+ x .})(+ 1 2)(f 10)", "20", {
+            lval_mut_num(expected, 20);
+        });
+    test_pass("(+ 1 2)(len (eval {.}))", "1", {
+            lval_mut_num(expected, 1);
+        });
+    test_pass("(fun {f n} {if (== n 0) {.} {f (- n 1)}})(len (f 3))", "2", {
+            lval_mut_num(expected, 2);
+        });
+    test_pass("(fun {f n} {if (== n 0) {0} {f (- n 1)}})(f 3)(+ . 1)", "1", {
+            lval_mut_num(expected, 1);
+        });
+    test_pass_after("(+ 1 2)(/ 1 0)", ".", "error", {
+            lval_mut_err_code(expected, LERR_DIV_ZERO);
+        });
+    test_pass_after("(/ 1 0)", "(+ 1 2) .", "3", {
+            lval_mut_num(expected, 3);
+        });
     /* Lamdba definition. */
     test_pass("(\\ {x} {* 2 x}) 4", "8", {
             lval_mut_num(expected, 8);
@@ -154,6 +253,37 @@ describe(lisp_eval, {
     test_pass("(= {r} 0)(loop {!= r 42} {(= {r} (+ r 1))})(r)", "42", {
             lval_mut_num(expected, 42);
         });
+    test_pass("(if (> 42 0) {+ 21 21} {0})(+ . 1)", "43", {
+            lval_mut_num(expected, 43);
+        });
+    test_pass("(def {when} if)(when false {1} {2})", "2", {
+            lval_mut_num(expected, 2);
+        });
+    test_pass("(def {if} (\\ {c t e} {e}))(if true {1} {2})", "{2}", {
+            lval_mut_qexpr(expected);
+            push_num(expected, 2);
+        });
+    test_pass("(fun {fib n} {if (< n 2) {n} {+ (fib (- n 1)) (fib (- n 2))}})(fib 15)", "610", {
+            lval_mut_num(expected, 610);
+        });
+    /* Formals are bound into the slots of the call frame. */
+    test_pass("(fun {f x} {(= {x} 5) x})(f 1)", "5", {
+            lval_mut_num(expected, 5);
+        });
+    test_pass("(fun {f x & r} {+ x (len r)})(f 1 2 3)", "3", {
+            lval_mut_num(expected, 3);
+        });
+    /* Tail calls. */
+    test_pass("(fun {f x} {g})(fun {g} {x})(f 7)", "7", {
+            lval_mut_num(expected, 7);
+        });
+    test_pass("(fun {f x} {g 2})(fun {g x} {x})(f 1)", "2", {
+            lval_mut_num(expected, 2);
+        });
+    /* Deeper than the C stack allows without tail call elimination. */
+    test_pass("(fun {count n} {if (== n 0) {0} {count (- n 1)}})(count 100000)", "0", {
+            lval_mut_num(expected, 0);
+        });
     /* List functions. */
     test_pass("map (\\ {x} {* 2 x}) {1 2 3 4}", "{2 4 6 8}", {
             lval_mut_qexpr(expected);
@@ -163,6 +293,23 @@ describe(lisp_eval, {
             push_num(expected, 8);
         });
 
+    test_pass("(def {inc} ((\\ {x y} {+ x y}) 1))(map inc {1 2 3})(inc 10)", "11", {
+            lval_mut_num(expected, 11);
+        });
+    test_pass("fold (\\ {a x} {+ a x}) 0 {1 2 3 4}", "10", {
+            lval_mut_num(expected, 10);
+        });
+    test_pass("map (:: + 1) {1 2}", "{2 3}", {
+            lval_mut_qexpr(expected);
+            push_num(expected, 2);
+            push_num(expected, 3);
+        });
+
+    /* Constants. */
+    test_consts_with(LEVAL_TREE, false, "tree");
+    test_consts_with(LEVAL_VM, false, "vm");
+    test_consts_with(LEVAL_VM, true, "vm-all");
+
     /* Errors. */
     test_fail("/ 10 0", LERR_DIV_ZERO);
     test_fail("1 + 1", LERR_EVAL);
@@ -171,7 +318,18 @@ describe(lisp_eval, {
     test_fail("+ 1 +", LERR_BAD_OPERAND);
     test_fail("+ 1 \"string\"", LERR_BAD_OPERAND);
     test_fail("+ 1 (!1)", LERR_BAD_SYMBOL);
+    test_fail("(fun {go n} {if (== n 0) {/ 1 0} {go (- n 1)}})(go 5)", LERR_DIV_ZERO);
     test_fail("- (", LERR_EVAL);
+    test_fail("if 1 {1} {2}", LERR_BAD_OPERAND);
+    test_fail("if true {/ 1 0} {2}", LERR_DIV_ZERO);
+    test_fail("loop {true} {gibberish}", LERR_BAD_SYMBOL);
+    test_fail("loop {+ 1 \"string\"} {1}", LERR_BAD_OPERAND);
+    /* Compiled signatures of the builtins. */
+    test_fail("+ 1 2 3 4 5 \"string\"", LERR_BAD_OPERAND);
+    test_fail("index \"string\" {1}", LERR_BAD_OPERAND);
+    test_fail("head {1} {2}", LERR_TOO_MANY_ARGS);
+    test_fail("% 1 0", LERR_DIV_ZERO);
+    test_fail("fold + 0 {1 2 3 nil \"string\"}", LERR_BAD_OPERAND);
 
 });
 
@@ -9,6 +9,9 @@
 #include "lenv.h"
 #include "lbuiltin_condition.h"
 #include "lbuiltin.h"
+#include "lsym.h"
+#include "leval.h"
+#include "lvm.h"
 
 #define LENGTH(arr) sizeof(arr)/sizeof(arr[0])
 
@@ -18,6 +21,26 @@ struct lfunc* lfunc_alloc(void) {
     return fun;
 }
 
+struct lfunc* lfunc_alloc_builtin(const struct lfunc* builtin, const char* symbol) {
+    if (!builtin || builtin->lisp_func || lval_len(builtin->args) > 0) {
+        return NULL;
+    }
+    struct lfunc* fun = calloc(1, sizeof(struct lfunc));
+    memcpy(fun, builtin, sizeof(struct lfunc));
+    fun->symbol = lsym_intern((symbol) ? symbol : builtin->symbol);
+    fun->scope = NULL;
+    fun->formals = NULL;
+    fun->body = NULL;
+    fun->code = NULL;
+    fun->locals = NULL;
+    fun->localc = 0;
+    /* Tells lfunc_call that fun can be partially applied. */
+    fun->args = lval_alloc();
+    lval_mut_qexpr(fun->args);
+    lfunc_compile_guards(fun);
+    return fun;
+}
+
 void lfunc_init(struct lfunc* fun) {
     if (!fun) {
         return;
@@ -35,15 +58,7 @@ void lfunc_set_symbol(struct lfunc* fun, const char* symbol) {
     if (!fun) {
         return;
     }
-    if (fun->symbol) {
-        free(fun->symbol);
-        fun->symbol = NULL;
-    }
-    if (symbol) {
-        size_t len = strlen(symbol);
-        fun->symbol = malloc(len+1);
-        strncpy(fun->symbol, symbol, len+1);
-    }
+    fun->symbol = lsym_intern(symbol);
 }
 
 void lfunc_clear(struct lfunc* fun) {
@@ -55,6 +70,11 @@ void lfunc_clear(struct lfunc* fun) {
     fun->body = NULL;
     lval_free(fun->args);
     fun->args = NULL;
+    lcode_free(fun->code);
+    fun->code = NULL;
+    free(fun->locals);
+    fun->locals = NULL;
+    fun->localc = 0;
 }
 
 void lfunc_free(struct lfunc* fun) {
@@ -62,10 +82,6 @@ void lfunc_free(struct lfunc* fun) {
         return;
     }
     lfunc_clear(fun);
-    if (fun->symbol) {
-        free(fun->symbol);
-        fun->symbol = NULL;
-    }
     free(fun);
 }
 
@@ -75,32 +91,58 @@ bool lfunc_copy(struct lfunc* dest, const struct lfunc* src) {
     }
     lfunc_clear(dest);
     memcpy(dest, src, sizeof(struct lfunc));
-    dest->symbol = NULL; // To not free src->symbol when calling set_symbol.
     lfunc_init(dest);
-    lfunc_set_symbol(dest, src->symbol);
+    lcode_retain(dest->code);
+    if (src->locals) {
+        dest->locals = malloc(src->localc * sizeof(const char*));
+        memcpy(dest->locals, src->locals, src->localc * sizeof(const char*));
+    }
     if (src->scope) {
         lenv_copy(dest->scope, src->scope);
     }
+    /* Lists are shared, they are copied on first mutation. */
     if (src->formals) {
-        lval_copy(dest->formals, src->formals);
+        lval_dup(dest->formals, src->formals);
     }
     if (src->body) {
-        lval_copy(dest->body, src->body);
-        lval_mut_sexpr(dest->body);
+        if (lval_type(src->body) == LVAL_SEXPR) {
+            lval_dup(dest->body, src->body);
+        } else {
+            lval_copy(dest->body, src->body);
+            lval_mut_sexpr(dest->body);
+        }
     }
     if (src->args) {
-        lval_copy(dest->args, src->args);
+        lval_dup(dest->args, src->args);
     }
+    lfunc_compile_guards(dest);
     return true;
 }
 
+void lfunc_resolve(struct lfunc* fun) {
+    free(fun->locals);
+    size_t len = lval_len(fun->formals);
+    fun->locals = calloc(len + 1, sizeof(const char*));
+    fun->localc = 0;
+    struct lval* sym = lval_alloc();
+    for (size_t a = 0; a < len; a++) {
+        lval_index(fun->formals, a, sym);
+        /* & is not bound: the last formal receives the optional arguments. */
+        if (a == len-2 && strcmp("&", lval_as_sym(sym)) == 0) {
+            continue;
+        }
+        fun->locals[fun->localc++] = lval_as_sym(sym);
+    }
+    lval_free(sym);
+}
+
 #define CHECK(cond) if (!(cond)) return false;
 bool lfunc_are_equal(const struct lfunc* left, const struct lfunc* right) {
     if (left == right) {
         return true;
     }
     CHECK(left && right);
-    CHECK(strcmp(left->symbol, right->symbol) == 0);
+    CHECK(left->symbol == right->symbol);
     CHECK(left->min_argc == right->min_argc);
     CHECK(left->max_argc == right->max_argc);
     CHECK(left->accumulator == right->accumulator);
@@ -109,14 +151,18 @@ bool lfunc_are_equal(const struct lfunc* left, const struct lfunc* right) {
     CHECK(left->init_neutral == right->init_neutral);
     CHECK(lval_are_equal(left->neutral, right->neutral));
     CHECK(left->func == right->func);
-    if (left->scope || right->scope) {
-        CHECK(lenv_are_equal(left->scope, right->scope));
-    }
-    if (left->formals || right->formals) {
-        CHECK(lval_are_equal(left->formals, right->formals));
-    }
-    if (left->body || right->body) {
-        CHECK(lval_are_equal(left->body, right->body));
+    /* Builtins don't use their scope, formals and body, which are not
+     * allocated for a lean builtin (see lfunc_alloc_builtin). */
+    if (left->lisp_func || right->lisp_func) {
+        if (left->scope || right->scope) {
+            CHECK(lenv_are_equal(left->scope, right->scope));
+        }
+        if (left->formals || right->formals) {
+            CHECK(lval_are_equal(left->formals, right->formals));
+        }
+        if (left->body || right->body) {
+            CHECK(lval_are_equal(left->body, right->body));
+        }
     }
     if (left->args || right->args) {
         CHECK(lval_are_equal(left->args, right->args));
@@ -157,17 +203,24 @@ size_t lfunc_print_to(const struct lfunc* fun, FILE* out) {
     }
 }
 
+#define LGUARDS_ALL (~0u)
+
+/** lfunc_check_guards checks the guards of mask on args, the guards after
+ ** the 32th are always checked. */
 static int lfunc_check_guards(
         const struct lfunc* fun,
-        const struct lguard* guards, size_t guardc,
+        const struct lguard* guards, size_t guardc, uint32_t mask,
         const struct lval* args, struct lval* acc) {
     int s = 0;
     struct lerr* err = NULL;
     for (size_t g = 0; g < guardc; g++) {
+        if (g < 32 && !(mask & (1u << g))) {
+            continue;
+        }
         const struct lguard* guard = &guards[g];
         /* Guard applied on a specific argument. */
         if (guard->argn > 0) {
-            struct lval* child = lval_alloc();
+            struct lval* child = lval_alloc_tmp();
             lval_index(args, guard->argn-1, child);
             if (0 != (s = (guard->condition)(guard->param, fun, child, &err))) {
                 lval_free(child);
@@ -183,7 +236,7 @@ static int lfunc_check_guards(
         if (guard->argn == 0) {
             size_t len = lval_len(args);
             for (size_t a = 0; a < len; a++) {
-                struct lval* child = lval_alloc();
+                struct lval* child = lval_alloc_tmp();
                 lval_index(args, a, child);
                 if (0 != (s = (guard->condition)(guard->param, fun, child, &err))) {
                     s = a+1;
@@ -211,35 +264,150 @@ static int lfunc_check_guards(
     return s;
 }
 
+#define LTYPE_MASK(type) (1u << (type))
+#define LTYPE_MASK_ALL   (~0u)
+
+/** lfunc_guard_mask returns the mask of the types allowed by guard or 0 if
+ ** the condition of guard is not a type check. */
+static uint32_t lfunc_guard_mask(const struct lguard* guard) {
+    lcondition condition = guard->condition;
+    if (condition == use_condition(must_be_numeric)) {
+        return LTYPE_MASK(LVAL_NIL) | LTYPE_MASK(LVAL_NUM)
+            | LTYPE_MASK(LVAL_BIGNUM) | LTYPE_MASK(LVAL_DBL);
+    }
+    if (condition == use_condition(must_be_integral)) {
+        return LTYPE_MASK(LVAL_NUM) | LTYPE_MASK(LVAL_BIGNUM);
+    }
+    if (condition == use_condition(must_be_a_list)) {
+        return LTYPE_MASK(LVAL_SEXPR) | LTYPE_MASK(LVAL_QEXPR) | LTYPE_MASK(LVAL_STR);
+    }
+    if (condition == use_condition(must_be_of_type)) {
+        return LTYPE_MASK(*((const enum ltype*)guard->param));
+    }
+    return 0;
+}
+
+void lfunc_compile_guards(struct lfunc* fun) {
+    struct lsignature* sig = &fun->signature;
+    memset(sig, 0, sizeof(struct lsignature));
+    /* must_have_func_ptr doesn't depend on the arguments: the guards
+     * report the error. */
+    if ((!fun->accumulator && !fun->func) || fun->guardc > 32) {
+        return;
+    }
+    sig->each = LTYPE_MASK_ALL;
+    for (size_t a = 0; a < LSIGNATURE_ARGN; a++) {
+        sig->at[a] = LTYPE_MASK_ALL;
+    }
+    for (int g = 0; g < fun->guardc; g++) {
+        const struct lguard* guard = &fun->guards[g];
+        uint32_t mask = lfunc_guard_mask(guard);
+        if (mask && guard->argn == 0) {
+            sig->each &= mask;
+        } else if (mask && guard->argn > 0 && guard->argn <= LSIGNATURE_ARGN
+                && guard->argn <= fun->min_argc) {
+            /* The argument is always there once argc is checked. */
+            sig->at[guard->argn-1] &= mask;
+        } else {
+            sig->rest |= 1u << g;
+        }
+    }
+    sig->compiled = true;
+}
+
+/** lfunc_check_signature tells if the argc values of argv pass the compiled
+ ** guards of fun. */
+static bool lfunc_check_signature(const struct lfunc* fun,
+        size_t argc, const struct lval* const* argv) {
+    const struct lsignature* sig = &fun->signature;
+    int len = (int)argc;
+    if ((fun->max_argc != -1 && len > fun->max_argc)
+            || (fun->min_argc != -1 && len < fun->min_argc)) {
+        return false;
+    }
+    for (int a = 0; a < len; a++) {
+        uint32_t type = LTYPE_MASK(lval_type(argv[a]));
+        if (!(type & sig->each)
+                || (a < LSIGNATURE_ARGN && !(type & sig->at[a]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** lfunc_passes_signature tells if the argc values of argv pass all the
+ ** guards of fun, which are then checked without a list of arguments. */
+static bool lfunc_passes_signature(const struct lfunc* fun,
+        size_t argc, const struct lval* const* argv) {
+    return fun->signature.compiled && fun->signature.rest == 0
+        && lfunc_check_signature(fun, argc, argv);
+}
+
+static struct lguard lbuitin_guards[] = {
+    {.argn= -1, .condition= use_condition(must_have_max_argc)},
+    {.argn= -1, .condition= use_condition(must_have_min_argc)},
+    {.argn= -1, .condition= use_condition(must_have_func_ptr)},
+};
+
+/** lfunc_check_all_guards checks the guards of fun on args. When the
+ ** compiled signature fails, the guards are checked one by one to report
+ ** the same error. */
+static int lfunc_check_all_guards(const struct lfunc* fun,
+        const struct lval* args, struct lval* acc) {
+    if (fun->signature.compiled
+            && lfunc_check_signature(fun, lval_len(args), lval_cells(args))) {
+        return lfunc_check_guards(fun, fun->guards, fun->guardc,
+                fun->signature.rest, args, acc);
+    }
+    int s = 0;
+    if (0 != (s = lfunc_check_guards(fun, &lbuitin_guards[0], LENGTH(lbuitin_guards),
+                    LGUARDS_ALL, args, acc))) {
+        return s;
+    }
+    return lfunc_check_guards(fun, fun->guards, fun->guardc, LGUARDS_ALL, args, acc);
+}
+
+/** lfunc_prepare_frame returns the frame in which the lisp function fun
+ ** is executed (freed by the caller), built from fun->scope.
+ ** The arguments are the elements of the list head followed by the argc
+ ** values of argv. fun itself is never mutated as it may be shared. */
+static struct lenv* lfunc_prepare_frame(const struct lfunc* fun, struct lenv* par,
+        const struct lval* head, size_t argc, const struct lval* const* argv) {
+    struct lenv* env = lenv_alloc_frame(fun->locals, fun->localc);
+    lenv_copy(env, fun->scope);
+    lenv_set_parent(env, par);
+    /* Bind local variables, arguments are shared. */
+    size_t headc = (head) ? lval_len(head) : 0;
+    size_t total = headc + argc;
+    size_t fixed = fun->localc;
+    if (fun->max_argc < 0 && fixed > 0) {
+        fixed--;
+    }
+    for (size_t a = 0; a < fixed && a < total; a++) {
+        lenv_bind(env, a, (a < headc) ? lval_index_ptr(head, a) : argv[a-headc]);
+    }
+    /* Special case when & is the argument right before last one. */
+    if (fixed < fun->localc) {
+        struct lval* rest = lval_alloc_tmp();
+        lval_mut_sexpr(rest);
+        for (size_t a = fixed; a < total; a++) {
+            lval_push(rest, (a < headc) ? lval_index_ptr(head, a) : argv[a-headc]);
+        }
+        struct lval* list = lval_alloc_tmp();
+        lfunc_exec(&lbuiltin_list, env, rest, list);
+        lenv_bind(env, fixed, list);
+        lval_free(list);
+        lval_free(rest);
+    }
+    return env;
+}
+
+/** lfunc_prepare_env returns the environment in which fun is executed.
+ ** For lisp functions, it is a new frame (see lfunc_prepare_frame). */
 static struct lenv* lfunc_prepare_env(
         const struct lfunc* fun, struct lenv* par, const struct lval* args) {
     if (fun->lisp_func) {
-        struct lval* largs = lval_alloc();
-        lval_copy(largs, args);
-        struct lenv* env = fun->scope;
-        lenv_set_parent(env, par);
-        /* Define local variable. */
-        size_t len = lval_len(fun->formals);
-        for (size_t a = 0; a < len; a++) {
-            struct lval* sym = lval_alloc();
-            lval_index(fun->formals, a, sym);
-            /* Special case when & is the argument right before last one. */
-            if (a == len-2 && strcmp("&", lval_as_sym(sym)) == 0) {
-                lval_index(fun->formals, a+1, sym);
-                struct lval* list = lval_alloc();
-                lfunc_exec(&lbuiltin_list, env, largs, list);
-                lenv_put(env, sym, list);
-                lval_free(list);
-                lval_free(sym);
-                break;
-            }
-            struct lval* arg = lval_pop(largs, 0);
-            lenv_put(env, sym, arg);
-            lval_free(sym);
-            lval_free(arg);
-        }
-        lval_free(largs);
-        return env;
+        return lfunc_prepare_frame(fun, par, args, 0, NULL);
     }
     return par;
 }
@@ -251,87 +419,240 @@ void lfunc_push_args(const struct lfunc* fun, const struct lval* args) {
     }
     size_t len = lval_len(args);
     for (size_t a = 0; a < len; a++) {
-        struct lval* arg = lval_alloc();
+        struct lval* arg = lval_alloc_tmp();
         lval_index(args, a, arg);
-        lval_push(fun->args, arg);
-        lval_free(arg);
+        lval_push_move(fun->args, arg);
     }
 }
 
-static struct lguard lbuitin_guards[] = {
-    {.argn= -1, .condition= use_condition(must_have_max_argc)},
-    {.argn= -1, .condition= use_condition(must_have_min_argc)},
-    {.argn= -1, .condition= use_condition(must_have_func_ptr)},
-};
-
-int lfunc_exec(const struct lfunc* fun, struct lenv* env,
-        const struct lval* args, struct lval* acc) {
-    if (!fun) {
-        struct lerr* err = lerr_throw(LERR_EVAL, "nil can't be executed");
-        lval_mut_err_ptr(acc, err);
-        return -1;
+/** lfunc_accumulate executes the accumulator builtin fun on acc and each of
+ ** the argc values of argv from first. */
+static int lfunc_accumulate(const struct lfunc* fun, struct lenv* env,
+        size_t argc, const struct lval* const* argv, size_t first, struct lval* acc) {
+    int s = 0;
+    for (size_t c = first; c < argc; c++) {
+        /* The kernel leaves the values it can't reduce to fun->func. */
+        if (fun->reduce && (c = fun->reduce(argc, argv, c, acc)) == argc) {
+            break;
+        }
+        int err = fun->func(env, argv[c], acc);
+        /* Break on error. */
+        if (err != 0) {
+            if (err == -1) {
+                s = err;
+            } else {
+                s = c + 1;
+            }
+            break;
+        }
     }
-    /* Partial application. */
-    if (fun->args) {
-        lfunc_push_args(fun, args);
-        int argc = lval_len(fun->args);
-        if (argc < fun->min_argc) {
-            lval_mut_func(acc, fun);
-            return 0;
+    return s;
+}
+
+/** lfunc_exec_accumulator executes the accumulator builtin fun on the argc
+ ** values of argv once checked. acc may be argv[0], it is then updated in
+ ** place (see lbi_func_fold), but it must not be another value of argv. */
+static int lfunc_exec_accumulator(const struct lfunc* fun, struct lenv* env,
+        size_t argc, const struct lval* const* argv, struct lval* acc) {
+    if (argc > 1 && !fun->init_neutral) {
+        /* Init acc with first argument. */
+        if (argv[0] != acc) {
+            lval_dup(acc, argv[0]);
         }
-        args = fun->args;
+        return lfunc_accumulate(fun, env, argc, argv, 1, acc);
     }
-    /* Guards */
-    int s = 0;
-    if (0 != (s = lfunc_check_guards(
-                    fun, &lbuitin_guards[0], LENGTH(lbuitin_guards), args, acc))) {
-        return s;
+    /* Init acc with neutral, argv[0] is kept aside if it is acc. */
+    struct lval* first = NULL;
+    if (argc > 0 && argv[0] == acc) {
+        first = lval_alloc_tmp();
+        lval_dup(first, acc);
+    }
+    lval_copy(acc, fun->neutral);
+    if (argc == 0) {
+        return 0;
     }
-    if (0 != (s = lfunc_check_guards(
-                    fun, fun->guards, fun->guardc, args, acc))) {
+    int s = fun->func(env, (first) ? first : argv[0], acc);
+    lval_free(first);
+    if (argc == 1) {
+        /* Special case for unary operations. */
         return s;
     }
-    /* Prepare environnement. */
-    env = lfunc_prepare_env(fun, env, args);
+    if (s != 0) {
+        return (s == -1) ? s : 1;
+    }
+    return lfunc_accumulate(fun, env, argc, argv, 1, acc);
+}
+
+/** lfunc_exec_in executes fun in env once args are bound and checked. */
+static int lfunc_exec_in(const struct lfunc* fun, struct lenv* env,
+        const struct lval* args, struct lval* acc) {
+    /* Lisp function executed by the VM or the tree walker. */
+    if (fun->lisp_func && leval_engine() == LEVAL_VM) {
+        return (lvm_exec_body(fun, env, acc)) ? 0 : 1;
+    }
     if (fun->lisp_func) {
-        args = fun->body;
+        return (leval_exec_body(fun, env, acc)) ? 0 : 1;
     }
     /* Builtin argument execution. */
     if (!fun->accumulator) {
         return fun->func(env, args, acc);
     }
     /* Builtin accumulator execution. */
-    size_t len = lval_len(args);
-    if (len == 1) {
-        /* Special case for unary operations. */
-        struct lval* lx = lval_alloc();
-        lval_index(args, 0, lx);      // lx is the first argument.
-        lval_copy(acc, fun->neutral); // acc is the neutral element.
-        int s = fun->func(env, lx, acc);
-        lval_free(lx);
+    return lfunc_exec_accumulator(fun, env, lval_len(args), lval_cells(args), acc);
+}
+
+/** lfunc_gather returns a new temporary list of the elements of head (may be
+ ** NULL) followed by the argc values of argv. */
+static struct lval* lfunc_gather(const struct lval* head,
+        size_t argc, const struct lval* const* argv) {
+    struct lval* args = lval_alloc_tmp();
+    lval_mut_qexpr(args);
+    size_t headc = lval_len(head);
+    const struct lval* const* cells = lval_cells(head);
+    for (size_t a = 0; a < headc; a++) {
+        lval_push(args, cells[a]);
+    }
+    for (size_t a = 0; a < argc; a++) {
+        lval_push(args, argv[a]);
+    }
+    return args;
+}
+
+/** lfunc_call_checked executes fun on args, its bound arguments included,
+ ** once its guards pass (see lfunc_call for local). */
+static int lfunc_call_checked(const struct lfunc* fun, struct lenv* env,
+        const struct lval* args, struct lval* acc, struct lenv** local) {
+    /* Guards */
+    int s = 0;
+    if (0 != (s = lfunc_check_all_guards(fun, args, acc))) {
         return s;
     }
-    if (fun->init_neutral) {
-        /* Init acc with neutral. */
-        lval_copy(acc, fun->neutral);
-    } else {
-        /* Init acc with first argument. */
-        lval_index(args, 0, acc);
+    /* Prepare environnement. */
+    struct lenv* frame = lfunc_prepare_env(fun, env, args);
+    if (fun->lisp_func && local) {
+        *local = frame;
+        return 0;
     }
-    for (size_t c = (fun->init_neutral) ? 0 : 1; c < len; c++) {
-        struct lval* child = lval_alloc();
-        lval_index(args, c, child);
-        int err = fun->func(env, child, acc);
-        /* Break on error. */
-        if (err != 0) {
-            if (err == -1) {
-                s = err;
-            } else {
-                s = c + 1;
+    if (fun->lisp_func) {
+        args = fun->body;
+    }
+    s = lfunc_exec_in(fun, frame, args, acc);
+    if (frame != env) {
+        lenv_free(frame);
+    }
+    return s;
+}
+
+/** lfunc_call executes fun like lfunc_exec.
+ ** If local is not NULL, the body of a lisp function is not executed:
+ ** *local is set to the environment it must be executed in. */
+static int lfunc_call(const struct lfunc* fun, struct lenv* env,
+        const struct lval* args, struct lval* acc, struct lenv** local) {
+    if (!fun) {
+        struct lerr* err = lerr_throw(LERR_EVAL, "nil can't be executed");
+        lval_mut_err_ptr(acc, err);
+        return -1;
+    }
+    /* Partial application: too few arguments, returns a new function. */
+    if (fun->args) {
+        int argc = lval_len(fun->args) + lval_len(args);
+        if (argc < fun->min_argc) {
+            lval_mut_func(acc, fun);
+            lfunc_push_args(lval_as_func(acc), args);
+            return 0;
+        }
+    }
+    /* Bound arguments come first. fun->args is left untouched
+     * as fun may be shared with other values. */
+    if (lval_len(fun->args) == 0) {
+        return lfunc_call_checked(fun, env, args, acc, local);
+    }
+    struct lval* all = lfunc_gather(fun->args, lval_len(args), lval_cells(args));
+    int s = lfunc_call_checked(fun, env, all, acc, local);
+    lval_free(all);
+    return s;
+}
+
+/** LFUNC_ARGV_MAX is the number of arguments, bound ones included, up to which
+ ** an accumulator builtin is executed straight from the values of argv. */
+#define LFUNC_ARGV_MAX 16
+
+/** lfunc_call_argv executes fun like lfunc_apply, see lfunc_call for local.
+ ** A lisp function without guards called with enough arguments gets its
+ ** frame bound from its bound arguments and argv, an accumulator builtin
+ ** whose signature checks its arguments reduces them from argv: no list is
+ ** built. */
+static int lfunc_call_argv(const struct lfunc* fun, struct lenv* env,
+        size_t argc, const struct lval* const* argv,
+        struct lval* acc, struct lenv** local) {
+    if (fun && fun->lisp_func && fun->guardc == 0) {
+        int total = (int)(lval_len(fun->args) + argc);
+        if (total >= fun->min_argc
+                && (fun->max_argc < 0 || total <= fun->max_argc)) {
+            struct lenv* frame = lfunc_prepare_frame(fun, env, fun->args, argc, argv);
+            if (local) {
+                *local = frame;
+                return 0;
             }
-            break;
+            int s = lfunc_exec_in(fun, frame, fun->body, acc);
+            lenv_free(frame);
+            return s;
+        }
+    }
+    if (fun && !fun->lisp_func && fun->accumulator) {
+        size_t boundc = lval_len(fun->args);
+        size_t total = boundc + argc;
+        const struct lval* combined[LFUNC_ARGV_MAX];
+        const struct lval* const* all = argv;
+        if (boundc > 0 && total <= LFUNC_ARGV_MAX) {
+            memcpy(combined, lval_cells(fun->args), boundc * sizeof(struct lval*));
+            memcpy(combined + boundc, argv, argc * sizeof(struct lval*));
+            all = combined;
         }
-        lval_free(child);
+        if (boundc == 0 || all == combined) {
+            /* acc may only be the first argument (see lfunc_exec_accumulator). */
+            bool aliased = false;
+            for (size_t a = 1; a < total; a++) {
+                aliased = aliased || all[a] == acc;
+            }
+            if (!aliased && lfunc_passes_signature(fun, total, all)) {
+                return lfunc_exec_accumulator(fun, env, total, all, acc);
+            }
+        }
+    }
+    /* Generic case: arguments are gathered into a list, the bound ones
+     * first unless fun is partially applied (see lfunc_call). */
+    if (fun && (int)(lval_len(fun->args) + argc) >= fun->min_argc) {
+        struct lval* args = lfunc_gather(fun->args, argc, argv);
+        int s = lfunc_call_checked(fun, env, args, acc, local);
+        lval_free(args);
+        return s;
     }
+    struct lval* args = lfunc_gather(NULL, argc, argv);
+    int s = lfunc_call(fun, env, args, acc, local);
+    lval_free(args);
     return s;
 }
+
+int lfunc_exec(const struct lfunc* fun, struct lenv* env,
+        const struct lval* args, struct lval* acc) {
+    return lfunc_call(fun, env, args, acc, NULL);
+}
+
+int lfunc_apply(const struct lfunc* fun, struct lenv* env,
+        size_t argc, const struct lval* const* argv, struct lval* acc) {
+    return lfunc_call_argv(fun, env, argc, argv, acc, NULL);
+}
+
+int lfunc_enter(const struct lfunc* fun, struct lenv* env,
+        size_t argc, const struct lval* const* argv,
+        struct lval* acc, struct lenv** local) {
+    *local = NULL;
+    return lfunc_call_argv(fun, env, argc, argv, acc, local);
+}
+
+int lfunc_enter_exec(const struct lfunc* fun, struct lenv* env,
+        const struct lval* args, struct lval* acc, struct lenv** local) {
+    *local = NULL;
+    return lfunc_call(fun, env, args, acc, local);
+}
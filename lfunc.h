@@ -2,6 +2,7 @@
 #define _H_LFUNC_
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 
@@ -19,6 +20,8 @@
     lbi_##name
 
 struct lfunc;
+/* Forward declaration of lcode, see lvm.h */
+struct lcode;
 
 /** lcondition evaluates a condition for the given operands.
  **   0 if success
@@ -43,6 +46,23 @@ struct lguard {
     int argn;
 };
 
+/** LSIGNATURE_ARGN is the number of leading arguments typed by a lsignature. */
+#define LSIGNATURE_ARGN 4
+
+/** lsignature is the compiled form of the guards of a function: the number
+ ** of arguments and their types are checked in one pass over the arguments.
+ ** A type mask has the bit (1 << type) set for each allowed ltype. */
+struct lsignature {
+    /** lsignature.compiled tells if the signature replaces the guards. */
+    bool compiled;
+    /** lsignature.each is the mask of the types allowed for each argument. */
+    uint32_t each;
+    /** lsignature.at is the mask of the types allowed for the nth+1 argument. */
+    uint32_t at[LSIGNATURE_ARGN];
+    /** lsignature.rest is the mask of the guards left to check one by one. */
+    uint32_t rest;
+};
+
 /** lbuiltin is a pointer to a builtin function.
  ** lbuiltin returns:
  **   0 if success
@@ -51,9 +71,15 @@ struct lguard {
 typedef int (*lbuiltin)(
         struct lenv* env, const struct lval* args, struct lval* result);
 
+/** lreduce is the bulk kernel of an accumulator builtin: it reduces acc and
+ ** the argc values of argv from first on raw values while they allow it.
+ ** lreduce returns the index of the first value not reduced. */
+typedef size_t (*lreduce)(size_t argc, const struct lval* const* argv,
+        size_t first, struct lval* acc);
+
 /** lfunc describes a builtin function. */
 struct lfunc {
-    char* symbol;
+    const char* symbol;
     /** lfunc.max_argc is the maximum number of arguments. */
     int max_argc;
     /** lfunc.min_argc is the minimum number of arguments. */
@@ -63,28 +89,41 @@ struct lfunc {
     /** lfunc.guards are functions that prevent execution of the function. */
     const struct lguard* guards;
     int guardc; /* Number of guards. */
+    /** lfunc.signature is the compiled form of the guards (see lfunc_compile_guards). */
+    struct lsignature signature;
     /** lfunc.init_neutral tells if the initial value of acc must be the neutral elem. */
     bool init_neutral;
     /** lfunc.neutral is the neutral element. */
     const struct lval* neutral;
     /** lfunc.func is the associated builtin function. */
     lbuiltin func;
+    /** lfunc.reduce is the bulk kernel of the accumulator (NULL if none). */
+    lreduce reduce;
     /* Functions defined as S-Expression (in lisp). */
     bool lisp_func;
     struct lenv* scope;   // Local scope of the function.
     struct lval* formals; // A Q-Expr: list of local symbols name.
     struct lval* body;    // A S-Expr: list of S-Expression to execute.
     struct lval* args;    // A Q-Expr: list of associated argument (partial function application).
+    struct lcode* code;   // Compiled body, NULL until first executed by the VM.
+    const char** locals;  // Symbols bound by the slots of a call frame (see lfunc_resolve).
+    size_t localc;        // Number of slots of a call frame.
 };
 
 /** lfunc_alloc creates a lfunc.
  ** Caller is respnsible for calling lfunc_free. */
 struct lfunc* lfunc_alloc(void);
+/** lfunc_alloc_builtin creates a lean copy of the builtin named symbol (its
+ ** own symbol if NULL): it has no scope, formals nor body, only an empty list
+ ** of bound arguments. It must not be mutated, partial application copies it.
+ ** It returns NULL if builtin is a lisp function or has bound arguments.
+ ** Caller is responsible for calling lfunc_free. */
+struct lfunc* lfunc_alloc_builtin(const struct lfunc* builtin, const char* symbol);
 /** lfunc_init ensures that dynamically allocated components of lfunc are allocated. */
 void lfunc_init(struct lfunc*);
 /** lfunc_clear clears lvals from fun. */
 void lfunc_clear(struct lfunc* fun);
-/** lfunc_set_symbol copies symbol to lfunc->symbol. */
+/** lfunc_set_symbol interns symbol into lfunc->symbol. */
 void lfunc_set_symbol(struct lfunc* fun, const char* symbol);
 /** lfunc_free frees fun.
  ** fun must not be used afterwards. */
@@ -94,6 +133,14 @@ void lfunc_free(struct lfunc* fun);
 bool lfunc_copy(struct lfunc* dest, const struct lfunc* src);
 /** lfunc_are_equal tells if two func are equal. */
 bool lfunc_are_equal(const struct lfunc*, const struct lfunc*);
+/** lfunc_compile_guards compiles the guards of fun into fun->signature.
+ ** Type and argc guards are compiled, other guards are kept in the
+ ** signature to be checked one by one. lfunc_copy compiles the copy. */
+void lfunc_compile_guards(struct lfunc* fun);
+/** lfunc_resolve lays out the call frame of the lisp function fun:
+ ** each formal is given a slot, the list of optional arguments (after &)
+ ** being the last one. It must be called once formals are set. */
+void lfunc_resolve(struct lfunc* fun);
 
 /** lfunc_exec is a lbuiltin.
  ** lfunc_exec returns:
@@ -102,6 +149,21 @@ bool lfunc_are_equal(const struct lfunc*, const struct lfunc*);
  **   n if nth argument generate an error */
 int lfunc_exec(
         const struct lfunc* fun, struct lenv* env, const struct lval* args, struct lval* acc);
+/** lfunc_apply is lfunc_exec on the argc arguments argv.
+ ** The bound arguments of fun and argv are combined without mutating fun;
+ ** a lisp function gets them bound into its frame without building a list. */
+int lfunc_apply(const struct lfunc* fun, struct lenv* env,
+        size_t argc, const struct lval* const* argv, struct lval* acc);
+/** lfunc_enter is lfunc_apply without the execution of the body of a lisp
+ ** function: *local is set to the environment in which the body must be
+ ** executed, the caller is responsible for calling lenv_free on it.
+ ** *local is NULL when acc already holds the result. */
+int lfunc_enter(const struct lfunc* fun, struct lenv* env,
+        size_t argc, const struct lval* const* argv,
+        struct lval* acc, struct lenv** local);
+/** lfunc_enter_exec is lfunc_enter on the list args (see lfunc_exec). */
+int lfunc_enter_exec(const struct lfunc* fun, struct lenv* env,
+        const struct lval* args, struct lval* acc, struct lenv** local);
 /** lfunc_push_args does partial application of fun on args. */
 void lfunc_push_args(const struct lfunc* fun, const struct lval* args);
 
@@ -0,0 +1,71 @@
+#include "lfunc.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lval.h"
+#include "lenv.h"
+#include "lbuiltin.h"
+
+#define BENCHMARK_IMPL
+#include "benchmark.h"
+
+#ifndef RUNS
+#define RUNS 100000
+#endif
+
+/* Builtin call on small arguments: dominated by the check of the guards.
+ * The static builtin checks its guards one by one, its copy (as bound in
+ * an environment) checks its compiled signature. */
+static void benchmark_call(const char* name, size_t runs,
+        const struct lfunc* builtin, bool compiled,
+        const struct lval* args, long expected) {
+    benchmark_display_banner(name, runs, "builtin call");
+    struct lenv* env = lenv_alloc();
+    lenv_default(env);
+    struct lfunc* fun = lfunc_alloc();
+    lfunc_copy(fun, builtin);
+    if (!compiled) {
+        fun->signature.compiled = false;
+    }
+    struct lval* r = lval_alloc();
+    long long stt = benchmark_get_time_ns();
+    for (size_t run = 0; run < runs; run++) {
+        int s = lfunc_exec(fun, env, args, r);
+        assert(s == 0);
+    }
+    long long end = benchmark_get_time_ns();
+    long x = 0;
+    assert(lval_as_num(r, &x) && x == expected);
+    lval_free(r);
+    lfunc_free(fun);
+    lenv_free(env);
+    benchmark_display_results(stt, end, runs);
+}
+
+int main(void)
+{
+    struct lval* num = lval_alloc();
+    struct lval* add_args = lval_alloc();
+    lval_mut_qexpr(add_args);
+    for (long n = 1; n <= 3; n++) {
+        lval_mut_num(num, n);
+        lval_push(add_args, num);
+    }
+    struct lval* index_args = lval_alloc();
+    lval_mut_qexpr(index_args);
+    lval_mut_num(num, 1);
+    lval_push(index_args, num);
+    lval_push(index_args, add_args);
+
+    benchmark_call("lfunc/guards/add", RUNS, &lbuiltin_op_add, false, add_args, 6);
+    benchmark_call("lfunc/signature/add", RUNS, &lbuiltin_op_add, true, add_args, 6);
+    benchmark_call("lfunc/guards/index", RUNS, &lbuiltin_index, false, index_args, 2);
+    benchmark_call("lfunc/signature/index", RUNS, &lbuiltin_index, true, index_args, 2);
+
+    lval_free(index_args);
+    lval_free(add_args);
+    lval_free(num);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,13 @@
+#ifndef _H_LGMP_
+#define _H_LGMP_
+
+/* Bignums use the mpz_* API of GMP.
+ * vendor/mini-gmp is the default, the system libgmp is used when built
+ * with `make GMP=system` (LGMP_SYSTEM). */
+#ifdef LGMP_SYSTEM
+#include <gmp.h>
+#else
+#include "vendor/mini-gmp/mini-gmp.h"
+#endif
+
+#endif
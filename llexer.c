@@ -4,6 +4,7 @@
 #include <string.h>
 
 #include "lerr.h"
+#include "lsym.h"
 
 const char* llex_type_string(enum ltok_type type) {
     switch (type) {
@@ -225,6 +226,10 @@ static struct ltok* llex_emit(struct lscanner* scanner) {
         return tok;
     }
     size_t len = scanner->width;
+    if (tok->type == LTOK_SYM) {
+        tok->content = (char*)lsym_intern_len(&scanner->input[scanner->start], len);
+        return tok;
+    }
     tok->content = malloc(len+1);
     memcpy(tok->content, &scanner->input[scanner->start], len);
     tok->content[len] = '\0';
@@ -334,7 +339,7 @@ void llex_free(struct ltok* tokens) {
     struct ltok *curr, *next = tokens;
     while ((curr = next)) {
         next = curr->next;
-        if (curr->content) {
+        if (curr->content && curr->type != LTOK_SYM) {
             free(curr->content);
         }
         if (curr->type == LTOK_EOF) {
@@ -23,6 +23,7 @@ enum ltok_type {
 
 struct ltok {
     enum ltok_type type;
+    /* For LTOK_SYM, content is an interned symbol (see lsym.h). */
     char* content;
     int   line;
     int   col;
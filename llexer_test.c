@@ -2,6 +2,8 @@
 
 #include <string.h>
 
+#include "lsym.h"
+
 #include "vendor/snow/snow/snow.h"
 
 struct token_list {
@@ -15,9 +17,13 @@ struct ltok* token_list_builder(const struct token_list* list) {
     do {
         struct ltok* curr = calloc(1, sizeof(struct ltok));
         curr->type = list->type;
-        size_t len = strlen(list->content);
-        curr->content = malloc(len+1);
-        strncpy(curr->content, list->content, len+1);
+        if (curr->type == LTOK_SYM) {
+            curr->content = (char*)lsym_intern(list->content);
+        } else {
+            size_t len = strlen(list->content);
+            curr->content = malloc(len+1);
+            strncpy(curr->content, list->content, len+1);
+        }
         *last = curr;
         last = &(curr->next);
     } while (++list && list->content != NULL);
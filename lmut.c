@@ -16,12 +16,13 @@ static struct lval* lmut_num(const struct last* ast, struct lerr** error) {
         mpz_t bignum;
         mpz_init_set_str(bignum, ast->content, 10);
         lval_mut_bignum(v, bignum);
-        v->ast = ast;
+        lval_set_ast(v, ast);
+        lval_freeze(v);
         mpz_clear(bignum);
         return v;
     }
     lval_mut_num(v, n);
-    v->ast = ast;
+    lval_set_ast(v, ast);
     return v;
 }
 
@@ -33,11 +34,11 @@ static struct lval* lmut_dbl(const struct last* ast, struct lerr** error) {
         *error = lerr_throw(LERR_BAD_OPERAND, "double number out of range");
         lerr_set_location(*error, ast->line, ast->col);
         lval_mut_err_ptr(v, *error);
-        v->ast = ast;
+        lval_set_ast(v, ast);
         return v;
     }
     lval_mut_dbl(v, d);
-    v->ast = ast;
+    lval_set_ast(v, ast);
     return v;
 }
 
@@ -45,7 +46,8 @@ static struct lval* lmut_sym(const struct last* ast, struct lerr** error) {
     *error = NULL;
     struct lval* v = lval_alloc();
     lval_mut_sym(v, ast->content);
-    v->ast = ast;
+    lval_set_ast(v, ast);
+    lval_freeze(v);
     return v;
 }
 
@@ -53,7 +55,8 @@ static struct lval* lmut_str(const struct last* ast, struct lerr** error) {
     *error = NULL;
     struct lval* v = lval_alloc();
     lval_mut_str(v, ast->content);
-    v->ast = ast;
+    lval_set_ast(v, ast);
+    lval_freeze(v);
     return v;
 }
 
@@ -75,11 +78,10 @@ void lmut_fill_list(struct lval* list, const struct last* ast, struct lerr** err
             *error = lerr_throw(LERR_AST, "can't read AST");
             lerr_set_location(*error, ast->line, ast->col);
             lval_mut_err_ptr(o, *error);
-            o->ast = ast;
+            lval_set_ast(o, ast);
             break;
         }
-        lval_push(list, o);
-        lval_free(o);
+        lval_push_move(list, o);
         /* Stop on error. */
         if (*error != NULL) {
             break;
@@ -90,16 +92,19 @@ void lmut_fill_list(struct lval* list, const struct last* ast, struct lerr** err
 static struct lval* lmut_qexpr(const struct last* ast, struct lerr** error) {
     struct lval* v = lval_alloc();
     lval_mut_qexpr(v);
-    v->ast = ast;
+    lval_set_ast(v, ast);
     /* Add children to the qexpr. */
     lmut_fill_list(v, ast, error);
+    if (!*error) {
+        lval_freeze(v);
+    }
     return v;
 }
 
 static struct lval* lmut_sexpr(const struct last* ast, struct lerr** error) {
     struct lval* v = lval_alloc();
     lval_mut_sexpr(v);
-    v->ast = ast;
+    lval_set_ast(v, ast);
     /* Dereference the inner expression. */
     ast = ast->children[0];
     /* Add children to the sexpr. */
@@ -121,7 +126,7 @@ struct lval* lisp_mut(const struct last* ast, struct lerr** error) {
     }
     /* A program is a list of SEXPR. */
     lval_mut_sexpr(p);
-    p->ast = ast;
+    lval_set_ast(p, ast);
     for (size_t c = 0; c < ast->childrenc; c++) {
         struct lval* s = NULL;
         if (ast->children[c]->tag == LTAG_SEXPR) {
@@ -131,10 +136,9 @@ struct lval* lisp_mut(const struct last* ast, struct lerr** error) {
             *error = lerr_throw(LERR_AST, "can't read AST");
             lerr_set_location(*error, ast->line, ast->col);
             lval_mut_err_ptr(s, *error);
-            s->ast = ast->children[c];
+            lval_set_ast(s, ast->children[c]);
         }
-        lval_push(p, s);
-        lval_free(s);
+        lval_push_move(p, s);
         if (*error != NULL) {
             break;
         }
@@ -10,6 +10,7 @@
 /** lisp_mut mutates an ast into a lval sexpr.
  ** ast has to start with a LTAG_PROG node.
  ** err is allocated in case of error.
+ ** Literals and Q-Expressions are constants (see lval_freeze).
  ** Caller is responsible for freeing returned lval. */
 struct lval* lisp_mut(const struct last* ast, struct lerr** error);
 
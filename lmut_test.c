@@ -1,7 +1,7 @@
 #include "lmut.h"
 
 #include <limits.h>
-#include "vendor/mini-gmp/mini-gmp.h"
+#include "lgmp.h"
 
 #include "lerr.h"
 #include "llexer.h"
@@ -4,6 +4,7 @@
 
 
 #include "lerr.h"
+#include "lsym.h"
 
 const char* last_tag_string(enum ltag tag) {
     switch (tag) {
@@ -20,13 +21,82 @@ const char* last_tag_string(enum ltag tag) {
     return NULL;
 }
 
+/* Table of the live nodes indexed by their id, ids of freed nodes are reused.
+ * Ids fit the 30 bits of lval.ast: nodes beyond are not registered. */
+#define LAST_MAX_ID ((1u << 30) - 1)
+
+static const struct last** last_table = NULL;
+static unsigned last_tablec = 1; // Id 0 is never used.
+static unsigned last_tablecap = 0;
+static unsigned* last_freed = NULL;
+static unsigned last_freedc = 0;
+static unsigned last_live = 0;
+
+/** last_register gives an id to ast. */
+static void last_register(struct last* ast) {
+    unsigned id = 0;
+    if (last_freedc > 0) {
+        id = last_freed[--last_freedc];
+    } else if (last_tablec <= LAST_MAX_ID) {
+        if (last_tablec >= last_tablecap) {
+            last_tablecap = (last_tablecap) ? 2 * last_tablecap : 256;
+            last_table = realloc(last_table, last_tablecap * sizeof(struct last*));
+            last_freed = realloc(last_freed, last_tablecap * sizeof(unsigned));
+        }
+        id = last_tablec++;
+    } else {
+        return;
+    }
+    last_table[id] = ast;
+    ast->id = id;
+    last_live++;
+}
+
+/** last_unregister gives the id of ast back. */
+static void last_unregister(struct last* ast) {
+    if (ast->id == 0) {
+        return;
+    }
+    last_table[ast->id] = NULL;
+    last_freed[last_freedc++] = ast->id;
+    ast->id = 0;
+    last_live--;
+}
+
+bool last_release(void) {
+    if (last_live > 0) {
+        return false;
+    }
+    free(last_table);
+    free(last_freed);
+    last_table = NULL;
+    last_freed = NULL;
+    last_tablec = 1;
+    last_tablecap = 0;
+    last_freedc = 0;
+    return true;
+}
+
+unsigned last_id(const struct last* ast) {
+    return (ast) ? ast->id : 0;
+}
+
+const struct last* last_from_id(unsigned id) {
+    return (id > 0 && id < last_tablec) ? last_table[id] : NULL;
+}
+
 static struct last* last_alloc(enum ltag tag, const char* content, const struct ltok* tok) {
     struct last* ast = calloc(1, sizeof(struct last));
+    last_register(ast);
     ast->tag = tag;
-    size_t len = strlen(content);
-    ast->content = malloc(len+1);
-    memcpy(ast->content, content, len);
-    ast->content[len] = '\0';
+    if (tag == LTAG_SYM) {
+        ast->content = (char*)lsym_intern(content);
+    } else {
+        size_t len = strlen(content);
+        ast->content = malloc(len+1);
+        memcpy(ast->content, content, len);
+        ast->content[len] = '\0';
+    }
     if (tok) {
         ast->line = tok->line;
         ast->col = tok->col;
@@ -329,9 +399,10 @@ void last_free(struct last* ast) {
         }
         free(ast->children);
     }
-    if (ast->content) {
+    if (ast->content && ast->tag != LTAG_SYM) {
         free(ast->content);
     }
+    last_unregister(ast);
     free(ast);
 }
 
@@ -23,12 +23,15 @@ enum ltag {
 struct last {
     enum ltag tag;
     enum lerr_code err;
+    /* For LTAG_SYM, content is an interned symbol (see lsym.h). */
     char* content;
     int line;
     int col;
     /* tree */
     struct last** children;
     size_t childrenc;
+    /* Index into the table of nodes (see last_id), 0 if not registered. */
+    unsigned id;
 };
 
 /** lisp_parse transforms a list of tokens into an ast.
@@ -40,6 +43,16 @@ struct last* lisp_parse(struct ltok* tokens, struct lerr** err);
  ** ast must not be used afterwards. */
 void last_free(struct last* ast);
 
+/** last_id returns the id of ast, 0 if ast is NULL.
+ ** Nodes built by lisp_parse are registered into a table of live nodes
+ ** so a lval refers to its source location by an id (see lval_ast). */
+unsigned last_id(const struct last* ast);
+/** last_from_id returns the live node of id, NULL if it had been freed. */
+const struct last* last_from_id(unsigned id);
+/** last_release frees the table of nodes.
+ ** It fails if a node is still alive. */
+bool last_release(void);
+
 /** last_are_equal tells if two ast nodes are equal. */
 bool last_are_equal(const struct last* left, const struct last* right);
 /** last_are_all_equal tells if two ast are equal. */ 
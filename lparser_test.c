@@ -6,6 +6,7 @@
 
 #include "lerr.h"
 #include "llexer.h"
+#include "lsym.h"
 
 #include "vendor/snow/snow/snow.h"
 
@@ -30,9 +31,13 @@ struct last* ast_builder(struct ast_list* list) {
         /* Create node. */
         struct last* node = calloc(1, sizeof(struct last));
         node->tag = curr->tag;
-        size_t len = strlen(curr->content);
-        node->content = malloc(len+1);
-        strncpy(node->content, curr->content, len+1);
+        if (node->tag == LTAG_SYM) {
+            node->content = (char*)lsym_intern(curr->content);
+        } else {
+            size_t len = strlen(curr->content);
+            node->content = malloc(len+1);
+            strncpy(node->content, curr->content, len+1);
+        }
         /* Save node into current list element. */
         curr->node = node;
         /* Set new root. */
@@ -264,6 +269,23 @@ describe(lparse, {
     test_fail("s-expr that starts right before the end of a line", "(");
     test_fail("q-expr which does not end with a `}`", "(head {1 2 3)");
 
+    it("registers the nodes by id", {
+        struct lerr* err = NULL;
+        defer(lerr_free(err));
+        struct ltok* tokens = NULL;
+        defer(llex_free(tokens));
+        assert(tokens = lisp_lex("+ 1 2", &err));
+        struct last* got = NULL;
+        assert(got = lisp_parse(tokens, &err));
+        unsigned id = last_id(got);
+        assert(id != 0);
+        assert(last_from_id(id) == got);
+        assert(!last_release());
+        last_free(got);
+        assert(last_from_id(id) == NULL);
+        assert(last_release());
+    });
+
 });
 
 snow_main();
@@ -0,0 +1,107 @@
+#include "lsym.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "generic/htable.h"
+
+/** LSYM_CAPACITY is the initial capacity of the symbol table.
+ ** It holds the default environment without growing. */
+#define LSYM_CAPACITY 256
+
+/** LSYM_SMALL_LEN is the length up to which lsym_intern_len copies the name
+ ** on the stack. */
+#define LSYM_SMALL_LEN 63
+
+/** lsym is an interned symbol. */
+struct lsym {
+    /** lsym.hash is ht_hash(lsym.name). */
+    uint64_t hash;
+    /** lsym.len is strlen(lsym.name). */
+    size_t len;
+    /** lsym.localc is the number of bindings of the symbol in local environments. */
+    size_t localc;
+    /** lsym.name is the symbol itself; lsym_intern returns a pointer to it. */
+    char name[];
+};
+
+/** lsym_table contains all interned symbols. */
+static struct htable* lsym_table = NULL;
+
+/** lsym_of returns the lsym containing the interned name sym. */
+static struct lsym* lsym_of(const char* sym) {
+    return (struct lsym*)(sym - offsetof(struct lsym, name));
+}
+
+const char* lsym_intern(const char* name) {
+    if (!name) {
+        return NULL;
+    }
+    if (!lsym_table) {
+        lsym_table = ht_alloc(LSYM_CAPACITY);
+    }
+    uint64_t hash = ht_hash(name);
+    struct lsym* sym = ht_lookup(lsym_table, name, hash);
+    if (sym) {
+        return sym->name;
+    }
+    size_t len = strlen(name);
+    sym = malloc(sizeof(struct lsym) + len+1);
+    sym->hash = hash;
+    sym->len = len;
+    sym->localc = 0;
+    memcpy(sym->name, name, len+1);
+    bool insertion = false;
+    ht_insert(lsym_table, sym->name, hash, sym, free, &insertion);
+    return sym->name;
+}
+
+const char* lsym_intern_len(const char* name, size_t len) {
+    if (!name) {
+        return NULL;
+    }
+    /* The length comes from the input: long names are copied on the heap. */
+    char small[LSYM_SMALL_LEN+1];
+    char* buffer = (len <= LSYM_SMALL_LEN) ? small : malloc(len+1);
+    if (!buffer) {
+        return NULL;
+    }
+    memcpy(buffer, name, len);
+    buffer[len] = '\0';
+    const char* sym = lsym_intern(buffer);
+    if (buffer != small) {
+        free(buffer);
+    }
+    return sym;
+}
+
+uint64_t lsym_hash(const char* sym) {
+    return lsym_of(sym)->hash;
+}
+
+size_t lsym_len(const char* sym) {
+    return lsym_of(sym)->len;
+}
+
+void lsym_set_local(const char* sym) {
+    lsym_of(sym)->localc++;
+}
+
+void lsym_unset_local(const char* sym) {
+    lsym_of(sym)->localc--;
+}
+
+bool lsym_is_local(const char* sym) {
+    return lsym_of(sym)->localc > 0;
+}
+
+size_t lsym_count(void) {
+    return ht_size(lsym_table);
+}
+
+void lsym_release(void) {
+    ht_free(lsym_table, free);
+    lsym_table = NULL;
+}
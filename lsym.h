@@ -0,0 +1,34 @@
+#ifndef _H_LSYM_
+#define _H_LSYM_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Symbols are interned: each distinct name is stored once for the lifetime
+ * of the program, so two symbols are equal iff their pointers are equal.
+ * The hash of each name is computed once and stored next to it. */
+
+/** lsym_intern returns the interned copy of name.
+ ** The returned pointer stays valid until lsym_release is called. */
+const char* lsym_intern(const char* name);
+/** lsym_intern_len interns the first len characters of name. */
+const char* lsym_intern_len(const char* name, size_t len);
+/** lsym_hash returns the hash of sym. sym must have been interned. */
+uint64_t lsym_hash(const char* sym);
+/** lsym_len returns strlen(sym). sym must have been interned. */
+size_t lsym_len(const char* sym);
+/** lsym_set_local counts a binding of sym in a local environment (see lenv).
+ ** sym must have been interned. */
+void lsym_set_local(const char* sym);
+/** lsym_unset_local forgets a binding counted by lsym_set_local. */
+void lsym_unset_local(const char* sym);
+/** lsym_is_local tells if sym is bound in a local environment. */
+bool lsym_is_local(const char* sym);
+/** lsym_count returns the number of interned symbols. */
+size_t lsym_count(void);
+/** lsym_release frees all interned symbols.
+ ** Symbols must not be used afterwards. */
+void lsym_release(void);
+
+#endif
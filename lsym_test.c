@@ -0,0 +1,60 @@
+#include "lsym.h"
+
+#include <string.h>
+
+#include "generic/htable.h"
+
+#include "vendor/snow/snow/snow.h"
+
+describe(lsym, {
+    it("interns a symbol once", {
+        char name[] = "symbol";
+        const char* sym = lsym_intern(name);
+        assert(sym && sym != name);
+        assert(strcmp(sym, name) == 0);
+        assert(lsym_intern("symbol") == sym);
+        assert(lsym_intern(sym) == sym);
+    });
+
+    it("interns different symbols to different pointers", {
+        assert(lsym_intern("a") != lsym_intern("b"));
+    });
+
+    it("interns the prefix of a string", {
+        const char* sym = lsym_intern_len("head tail", 4);
+        assert(sym == lsym_intern("head"));
+    });
+
+    it("interns the prefix of a long string", {
+        size_t len = 1 << 24;
+        char* name = malloc(len+2);
+        defer(free(name));
+        memset(name, 'x', len+1);
+        name[len+1] = '\0';
+        const char* sym = lsym_intern_len(name, len);
+        assert(sym && lsym_len(sym) == len);
+        name[len] = '\0';
+        assert(lsym_intern(name) == sym);
+    });
+
+    it("stores the hash and the length of a symbol", {
+        const char* sym = lsym_intern("lambda");
+        assert(lsym_hash(sym) == ht_hash("lambda"));
+        assert(lsym_len(sym) == strlen("lambda"));
+    });
+
+    it("counts interned symbols", {
+        size_t count = lsym_count();
+        lsym_intern("count-me");
+        lsym_intern("count-me");
+        assert(lsym_count() == count + 1);
+    });
+
+    it("releases all symbols", {
+        lsym_intern("x");
+        lsym_release();
+        assert(lsym_count() == 0);
+    });
+});
+
+snow_main();
@@ -1,10 +1,18 @@
 #include "lval.h"
 
+#include <limits.h>
 #include <math.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#include "generic/htable.h"
+#include "generic/mempool.h"
+#include "lparser.h"
+#include "lsym.h"
 
 #include "lfunc.h"
 
@@ -14,36 +22,79 @@
 #define INLINE
 #endif
 
-/** ldata is the return type of an evalution. */
+/** ldata is the return type of an evalution.
+ ** Laid out for density: the alive code and the 32-bit refc fill the first
+ ** word, the type and the flags (one byte each) and the 32-bit len the second,
+ ** lengths are 32 bits (see LDATA_MAX_LEN), the tracking links of the cycle
+ ** collector are in a lgc_node put before the ldata only when it is tracked. */
 struct ldata {
     /** ldata.alive is a code used to detect mutation.
      ** This ldata is dead if set to 0. */
     int alive;
-    /** refc is the number of lval referencing this ldata. */
-    int refc;
+    /** refc is the number of lval referencing this ldata.
+     ** Not counted for IMMORTAL ldata. */
+    uint32_t refc;
+    /** ldata.type to use the union (enum ltype). */
+    uint8_t type;
     /** ldata.mutable tells if the ldata is mutable, associated lval can't be modified. */
     bool mutable;
-    /** ldata.type to use the union. */
-    enum ltype type;
+    /** ldata.block tells the allocator where the ldata comes from. */
+    uint8_t block;
+    /** ldata.tracked tells if the ldata follows a lgc_node (see lgc_node). */
+    bool tracked;
     /** ldata.len value:
      ** LVAL_NIL = 0;
      ** LVAL_BOOL, LVAL_NUM, LVAL_BIGNUM, LVAL_DBL, LVAL_FUNC, LVAL_ERR = 1;
      ** LVAL_STR, LVAL_SYM = strlen(str);
      ** LVAL_SEXPR, LVAL_QEXPR = number of elements. */
-    size_t len;
+    uint32_t len;
+    /** ldata.cap is the capacity of the buffer of cells of a list and
+     ** ldata.head the position of its first cell into it: there is room
+     ** at both ends so cells are pushed and consed without moving others.
+     ** For a LVAL_STR, ldata.cap is the size of its heap buffer,
+     ** 0 when the string is short enough to be stored in payload.sso.
+     ** An emptied string has no buffer at all: cap is 1, payload.str NULL. */
+    uint32_t cap;
+    uint32_t head;
     /** ldata.payload must be considered according to ldata.type */
     union {
         bool          boolean;
         long          num;
         mpz_t         bignum; // int > LONG_MAX.
         double        dbl;
-        char*         str;    // string or symbol.
+        char*         str;    // string.
+        char          sso[sizeof(mpz_t)]; // short string, see ldata_str.
+        const char*   sym;    // interned symbol (see lsym.h).
         struct lval** cell;   // list of lval (can detect data mutation).
         struct lfunc* func;   // pointer to a function descriptor.
         struct lerr*  err;    // error.
     } payload;
 };
 
+/* The layout above makes a ldata five words long on LP64 (88 bytes unpacked),
+ * keep it so: each element of a list pays for a handle and a ldata. */
+_Static_assert(sizeof(void*) != 8 || sizeof(struct ldata) <= 40,
+        "struct ldata outgrew its packed layout");
+
+/** lgc_node links the ldata tracked by the cycle collector, lgc_node.refs
+ ** is its working count (see lval_gc_collect). The ldata follows it. */
+struct lgc_node {
+    struct lgc_node* prev;
+    struct lgc_node* next;
+    long refs;
+};
+
+static INLINE struct lgc_node* lgc_node(const struct ldata* d) {
+    return (struct lgc_node*)d - 1;
+}
+
+static INLINE struct ldata* lgc_data(struct lgc_node* n) {
+    return (struct ldata*)(n + 1);
+}
+
+/* Longest string stored inline into ldata.payload.sso. */
+#define LDATA_SSO_LEN (sizeof(((struct ldata*)0)->payload.sso) - 1)
+
 /* ldata.alive special status. */
 #define DEAD      0
 #define IMMORTAL -1
@@ -76,8 +127,9 @@ static const struct ldata ldata_zero = {
     .payload.num = 0
 };
 const struct lval lzero = {
-    .alive = IMMORTAL,
-    .data  = (struct ldata*) &ldata_zero
+    .alive   = IMMORTAL,
+    .data    = (struct ldata*) &ldata_zero,
+    .imm.num = 0
 };
  static const struct ldata ldata_one = {
     .alive       = IMMORTAL,
@@ -87,8 +139,9 @@ const struct lval lzero = {
     .payload.num = 1
 };
 const struct lval lone = {
-    .alive = IMMORTAL,
-    .data  = (struct ldata*) &ldata_one
+    .alive   = IMMORTAL,
+    .data    = (struct ldata*) &ldata_one,
+    .imm.num = 1
 };
  static const struct ldata ldata_emptyq = {
     .alive        = IMMORTAL,
@@ -111,6 +164,44 @@ static struct ldata ldata_init = {
     .len         = 0,
     .payload.num = 0
 };
+/** ldata_bool, ldata_num and ldata_dbl are shared by all the immediate lval
+ ** of their type, the payload being in lval.imm. Same trick as ldata_init. */
+static struct ldata ldata_bool = {
+    .alive       = IMMORTAL,
+    .mutable     = true,
+    .refc        = 1,
+    .type        = LVAL_BOOL,
+    .len         = 1,
+    .payload.num = 0
+};
+static struct ldata ldata_num = {
+    .alive       = IMMORTAL,
+    .mutable     = true,
+    .refc        = 1,
+    .type        = LVAL_NUM,
+    .len         = 1,
+    .payload.num = 0
+};
+static struct ldata ldata_dbl = {
+    .alive       = IMMORTAL,
+    .mutable     = true,
+    .refc        = 1,
+    .type        = LVAL_DBL,
+    .len         = 1,
+    .payload.num = 0
+};
+
+/** ldata_immediate returns the ldata shared by immediate lval of type,
+ ** NULL if values of this type are not immediate. */
+static INLINE struct ldata* ldata_immediate(enum ltype type) {
+    switch (type) {
+    case LVAL_NIL:  return &ldata_init;
+    case LVAL_BOOL: return &ldata_bool;
+    case LVAL_NUM:  return &ldata_num;
+    case LVAL_DBL:  return &ldata_dbl;
+    default:        return NULL;
+    }
+}
 
 /** lvalp_unique returns a hopefully unique number. */
 static int lval_unique() {
@@ -118,29 +209,30 @@ static int lval_unique() {
     return ++last; /* Does the trick for now. */
 }
 
-/** ldata_clear clears the internal memory of d.
- ** d is set to nil. */
-static bool ldata_clear(struct ldata* d) {
-    if (!d || !d->mutable) {
-        return false;
-    }
+/** ldata_clear_payload frees the payload of d which becomes a nil.
+ ** The handles connected to d stay alive. */
+static void ldata_clear_payload(struct ldata* d) {
     switch (d->type) {
     case LVAL_BIGNUM:
         mpz_clear(d->payload.bignum);
         break;
     case LVAL_STR:
-    case LVAL_SYM:
-        if (d->payload.str) {
+        if (d->cap > 0) {
             free(d->payload.str);
             d->payload.str = NULL;
         }
         break;
+    case LVAL_SYM:
+        d->payload.sym = NULL;
+        break;
     case LVAL_SEXPR:
     case LVAL_QEXPR:
         for (size_t c = 0; c < d->len; c++) {
             lval_free(d->payload.cell[c]);
         }
-        free(d->payload.cell);
+        if (d->payload.cell) {
+            free(d->payload.cell - d->head);
+        }
         d->payload.cell = NULL;
         break;
     case LVAL_FUNC:
@@ -153,27 +245,312 @@ static bool ldata_clear(struct ldata* d) {
         break;
     default: break;
     }
-    d->alive       = lval_unique();
-    d->mutable     = true;
-    d->refc        = 0;
     d->type        = LVAL_NIL;
     d->len         = 0;
+    d->cap         = 0;
+    d->head        = 0;
     d->payload.num = 0;
+}
+
+/** ldata_clear clears the internal memory of d.
+ ** d is set to nil. */
+static bool ldata_clear(struct ldata* d) {
+    if (!d || !d->mutable) {
+        return false;
+    }
+    ldata_clear_payload(d);
+    d->alive       = lval_unique();
+    d->mutable     = true;
+    d->refc        = 0;
     return true;
 }
 
+/** LDATA_MAX_LEN is the maximum length of a list or a string: ldata.len and
+ ** ldata.cap are 32 bits and a string needs one more char for its '\0'. */
+#define LDATA_MAX_LEN ((size_t)UINT32_MAX - 1)
+
+/* Buffer of cells of lists. */
+#define LDATA_MIN_CAP 4
+
+/** ldata_cells_resize moves the cells of d into a new buffer of cap cells,
+ ** the first one being at head. */
+static void ldata_cells_resize(struct ldata* d, size_t cap, size_t head) {
+    struct lval** buffer = malloc(cap * sizeof(struct lval*));
+    if (d->len > 0) {
+        memcpy(buffer + head, d->payload.cell, d->len * sizeof(struct lval*));
+    }
+    if (d->payload.cell) {
+        free(d->payload.cell - d->head);
+    }
+    d->payload.cell = buffer + head;
+    d->cap = cap;
+    d->head = head;
+}
+
+/** ldata_cells_reserve makes room for one cell at the front or the back of d.
+ ** The capacity doubles, the room at the other end is kept up to half
+ ** of the free cells. It fails if d already has LDATA_MAX_LEN cells. */
+static bool ldata_cells_reserve(struct ldata* d, bool front) {
+    size_t back_room = d->cap - d->head - d->len;
+    if ((front && d->head > 0) || (!front && back_room > 0)) {
+        return true;
+    }
+    if (d->len >= LDATA_MAX_LEN) {
+        return false;
+    }
+    size_t cap = 2 * (size_t)d->len;
+    if (cap < LDATA_MIN_CAP) {
+        cap = LDATA_MIN_CAP;
+    }
+    if (cap > LDATA_MAX_LEN) {
+        cap = LDATA_MAX_LEN;
+    }
+    size_t room = cap - d->len;
+    size_t head = 0;
+    if (front) {
+        size_t kept = (back_room < room/2) ? back_room : room/2;
+        head = room - kept;
+    } else {
+        head = (d->head < room/2) ? d->head : room/2;
+    }
+    ldata_cells_resize(d, cap, head);
+    return true;
+}
+
+/** ldata_cells_shrink gives memory back once d uses a quarter of its buffer. */
+static void ldata_cells_shrink(struct ldata* d) {
+    if (d->len == 0) {
+        free(d->payload.cell - d->head);
+        d->payload.cell = NULL;
+        d->cap = 0;
+        d->head = 0;
+        return;
+    }
+    if (d->cap <= 4 * LDATA_MIN_CAP || d->len > d->cap/4) {
+        return;
+    }
+    size_t cap = d->cap/2;
+    size_t room = cap - d->len;
+    ldata_cells_resize(d, cap, (d->head < room/2) ? d->head : room/2);
+}
+
+/* Buffer of strings. */
+
+/** ldata_str returns the characters of the string d. */
+static INLINE char* ldata_str(const struct ldata* d) {
+    return (d->cap > 0) ? d->payload.str : (char*) d->payload.sso;
+}
+
+/** ldata_str_reserve makes room for len characters and '\0' into d.
+ ** The string stays inline as long as it is short enough.
+ ** It fails if len is greater than LDATA_MAX_LEN. */
+static bool ldata_str_reserve(struct ldata* d, size_t len) {
+    if (len > LDATA_MAX_LEN) {
+        return false;
+    }
+    if (d->cap > 0 && !d->payload.str) {
+        d->cap = 0;
+        d->payload.sso[0] = '\0';
+    }
+    if (len + 1 <= ((d->cap > 0) ? d->cap : LDATA_SSO_LEN + 1)) {
+        return true;
+    }
+    size_t cap = 2 * (size_t)d->cap;
+    if (cap < len + 1) {
+        cap = len + 1;
+    }
+    if (cap > LDATA_MAX_LEN + 1) {
+        cap = LDATA_MAX_LEN + 1;
+    }
+    if (d->cap > 0) {
+        d->payload.str = realloc(d->payload.str, cap);
+    } else {
+        char* buffer = malloc(cap);
+        memcpy(buffer, d->payload.sso, d->len + 1);
+        d->payload.str = buffer;
+    }
+    d->cap = cap;
+    return true;
+}
+
+/* Allocator.
+ * The origin of a block is kept into the handle or the ldata it holds
+ * (lval.block, ldata.block), so a block is always given back to the allocator
+ * which created it. Only the blocks of memory pools are prefixed by their
+ * mempool handle. */
+#define LALLOC_POOL_BLOCKC 4096
+
+enum lblock {
+    LBLOCK_HEAP = 0, // malloc'ed.
+    LBLOCK_POOL,     // From a memory pool.
+    LBLOCK_ARENA,    // Temporary handle.
+    LBLOCK_CONST,    // Constant, freed by lconst_drop.
+};
+
+/** LCONST_REFC is the reference held by the pool on its constants. */
+#define LCONST_REFC 1
+
+static enum lalloc_mode lalloc_mode = LALLOC_MALLOC;
+static struct mp_cluster* lval_pool = NULL;
+static struct mp_cluster* ldata_pool = NULL;
+static struct mp_cluster* lgc_pool = NULL; // Tracked ldata.
+static size_t lalloc_handles = 0;
+static size_t lalloc_data = 0;
+
+/* Collector: the tracked ldata are linked after lgc_heap. */
+static enum lgc_mode lgc_mode = LGC_REFC;
+static struct lgc_node lgc_heap = {
+    .prev = &lgc_heap,
+    .next = &lgc_heap
+};
+static size_t lgc_tracked = 0;
+static size_t lgc_threshold = 0;
+static struct lgc_stats lgc_stats = {0};
+
+void lval_set_alloc_mode(enum lalloc_mode mode) {
+    lalloc_mode = mode;
+}
+
+enum lalloc_mode lval_alloc_mode(void) {
+    return lalloc_mode;
+}
+
+/* Arena of temporary handles.
+ * Handles are bump allocated from chunks which are never moved. A freed
+ * handle is given back once all the handles allocated after it are freed,
+ * lval_arena_release gives back all the handles allocated since a mark. */
+#define LARENA_CHUNK 256
+
+static struct lval** larena_chunks = NULL;
+static size_t larena_chunkc = 0;
+static size_t larena_top = 0; // Number of slots in use.
+
+static INLINE struct lval* larena_slot(size_t s) {
+    return &larena_chunks[s / LARENA_CHUNK][s % LARENA_CHUNK];
+}
+
+/** larena_pop gives back the freed handles on top of the arena. */
+static void larena_pop(void) {
+    while (larena_top > 0 && !larena_slot(larena_top-1)->data) {
+        larena_top--;
+    }
+}
+
+/** larena_free frees the chunks of the arena if it is empty. */
+static void larena_free(void) {
+    if (larena_top > 0) {
+        return;
+    }
+    for (size_t c = 0; c < larena_chunkc; c++) {
+        free(larena_chunks[c]);
+    }
+    free(larena_chunks);
+    larena_chunks = NULL;
+    larena_chunkc = 0;
+}
+
+static void lconst_drop(struct ldata* d);
+static void lconst_release(void);
+
+bool lval_alloc_release(void) {
+    /* Constants hold handles. */
+    lconst_release();
+    if ((lval_pool && !mp_cluster_is_empty(lval_pool))
+     || (ldata_pool && !mp_cluster_is_empty(ldata_pool))
+     || (lgc_pool && !mp_cluster_is_empty(lgc_pool))) {
+        return false;
+    }
+    mp_cluster_free(&lval_pool);
+    mp_cluster_free(&ldata_pool);
+    mp_cluster_free(&lgc_pool);
+    larena_free();
+    return true;
+}
+
+void lval_alloc_count(size_t* handles, size_t* data) {
+    *handles = lalloc_handles;
+    *data = lalloc_data;
+}
+
+void lval_alloc_sizes(size_t* handle, size_t* data) {
+    *handle = sizeof(struct lval);
+    *data = sizeof(struct ldata);
+}
+
+/** lalloc returns a block of size bytes, block is set to its origin.
+ ** The block is not zeroed: callers clear it with a constant size, which
+ ** compiles to a few stores (a memset of a variable size may be a slow
+ ** string instruction). */
+static void* lalloc(struct mp_cluster** pool, size_t size, enum lblock* block) {
+    if (lalloc_mode == LALLOC_POOL) {
+        /* The mempool puts a uint64_t header before each block. */
+        size_t block_size = (2*sizeof(uint64_t) + size + 15) / 16 * 16 - sizeof(uint64_t);
+        if (!*pool) {
+            *pool = mp_cluster_alloc(mp_pool_alloc(LALLOC_POOL_BLOCKC, block_size));
+        }
+        uint64_t handle = 0;
+        uint64_t* prefixed = mp_take(*pool, &handle);
+        if (prefixed) {
+            *prefixed = handle;
+            *block = LBLOCK_POOL;
+            return prefixed+1;
+        }
+    }
+    *block = LBLOCK_HEAP;
+    return malloc(size);
+}
+
+/** lfree gives ptr back to the allocator it comes from. */
+static void lfree(struct mp_cluster* pool, void* ptr, enum lblock block) {
+    switch (block) {
+    case LBLOCK_HEAP:  free(ptr); break;
+    case LBLOCK_POOL:  mp_free(pool, *((uint64_t*)ptr - 1)); break;
+    case LBLOCK_ARENA: larena_pop(); break;
+    case LBLOCK_CONST: break;
+    }
+}
+
 /** ldata_alloc allocates a new ldata. Initialized to LVAL_NIL. */
 static struct ldata* ldata_alloc(void) {
-    /* Heap allocation for the moment.
-     * Allocation from a ldata pool later.
-     * Memory is set to 0. */
-    struct ldata* data = calloc(1, sizeof(struct ldata));
+    /* Memory is set to 0. */
+    enum lblock block = LBLOCK_HEAP;
+    struct ldata* data = NULL;
+    if (lgc_mode == LGC_TRACE) {
+        struct lgc_node* node =
+            lalloc(&lgc_pool, sizeof(struct lgc_node) + sizeof(struct ldata), &block);
+        memset(node, 0, sizeof(struct lgc_node) + sizeof(struct ldata));
+        node->prev = &lgc_heap;
+        node->next = lgc_heap.next;
+        lgc_heap.next->prev = node;
+        lgc_heap.next = node;
+        lgc_tracked++;
+        data = lgc_data(node);
+        data->tracked = true;
+    } else {
+        data = lalloc(&ldata_pool, sizeof(struct ldata), &block);
+        memset(data, 0, sizeof(struct ldata));
+    }
+    lalloc_data++;
+    data->block = block;
     data->type = LVAL_NIL;
     data->mutable = true;
     ldata_clear(data);
     return data;
 }
 
+/** ldata_free gives the cleared d back to its allocator. */
+static void ldata_free(struct ldata* d) {
+    if (d->tracked) {
+        struct lgc_node* node = lgc_node(d);
+        node->prev->next = node->next;
+        node->next->prev = node->prev;
+        lgc_tracked--;
+        lfree(lgc_pool, node, d->block);
+        return;
+    }
+    lfree(ldata_pool, d, d->block);
+}
+
 /** lval_connect connects a v to d.
  ** v is connected to lnil (immutable) by default. */
 static void lval_connect(struct lval* v, struct ldata* d) {
@@ -186,22 +563,56 @@ static void lval_connect(struct lval* v, struct ldata* d) {
     }
     v->data  = d;
     v->alive = d->alive;
-    v->data->refc++;
+    if (d->alive != IMMORTAL) {
+        d->refc++;
+    }
 }
 
+static struct ldata* lval_disconnect(struct lval* v, bool reuse);
+
 static void lval_kill(struct lval* v);
 
+/** lval_link connects v to the data of src.
+ ** An immediate payload is copied, v is connected to its shared ldata. */
+static INLINE void lval_link(struct lval* v, const struct lval* src) {
+    struct ldata* imm = ldata_immediate(src->data->type);
+    if (imm) {
+        lval_connect(v, imm);
+        v->imm = src->imm;
+        return;
+    }
+    lval_connect(v, src->data);
+}
+
+/** lval_mut_immediate mutates v to the immediate type, the payload is set by
+ ** the caller. No ldata is allocated. */
+static bool lval_mut_immediate(struct lval* v, enum ltype type) {
+    if (!lval_is_mutable(v)) {
+        return false;
+    }
+    struct ldata* imm = ldata_immediate(type);
+    if (v->data != imm) {
+        lval_disconnect(v, false);
+        lval_connect(v, imm);
+    }
+    v->ast = 0;
+    return true;
+}
+
 /** lval_disconnect disconnects v from its ldata.
  ** v->data is reclaimed if refc = 0. */
 static struct ldata* lval_disconnect(struct lval* v, bool reuse) {
     if (!v->data->mutable) {
         return NULL;
     }
-    if (v->data->refc > 0) {
+    if (v->data->refc > 0 && v->data->alive != IMMORTAL) {
         v->data->refc--;
     }
     bool dead = v->data->refc == 0;
     struct ldata* data = v->data;
+    /* A constant is dropped once only the pool holds it. */
+    struct ldata* constant = (data->block == LBLOCK_CONST
+            && data->refc == LCONST_REFC) ? data : NULL;
     if (reuse) {
         if (dead) {
             /* Reuse data. */
@@ -214,7 +625,7 @@ static struct ldata* lval_disconnect(struct lval* v, bool reuse) {
         if (dead) {
             ldata_clear(data);
             if (data->alive != IMMORTAL) {
-                free(data);
+                ldata_free(data);
             }
         }
         data = NULL;
@@ -222,6 +633,9 @@ static struct ldata* lval_disconnect(struct lval* v, bool reuse) {
     /* Kill handle. */
     v->data = NULL;
     lval_kill(v);
+    if (constant) {
+        lconst_drop(constant);
+    }
     return data;
 }
 
@@ -232,19 +646,213 @@ static void lval_kill(struct lval* v) {
     }
     v->alive = DEAD;
     v->data = NULL;
-    v->ast = NULL;
+    v->ast = 0;
+}
+
+/* Cycle collector.
+ * Reference counting reclaims everything but cycles. The collector finds
+ * them among the tracked ldata: the references held by tracked ldata are
+ * subtracted from the refc of their targets, what remains are references
+ * from the roots (env, VM stack, handles held by callers...). All that is
+ * not reachable from an ldata referenced by a root is garbage. */
+#define LGC_REACHABLE LONG_MIN
+#define LGC_MIN_THRESHOLD 4096
+
+void lval_set_gc_mode(enum lgc_mode mode) {
+    lgc_mode = mode;
+}
+
+enum lgc_mode lval_gc_mode(void) {
+    return lgc_mode;
+}
+
+void lval_gc_stats(struct lgc_stats* stats) {
+    *stats = lgc_stats;
+}
+
+/** ldata_visit calls visit on each handle held by d. */
+static void ldata_visit(const struct ldata* d,
+        void (*visit)(const struct lval* v, void* param), void* param) {
+    switch (d->type) {
+    case LVAL_SEXPR:
+    case LVAL_QEXPR:
+        for (size_t c = 0; c < d->len; c++) {
+            visit(d->payload.cell[c], param);
+        }
+        break;
+    case LVAL_FUNC:
+        {
+        const struct lfunc* fun = d->payload.func;
+        if (!fun) {
+            break;
+        }
+        if (fun->formals) visit(fun->formals, param);
+        if (fun->body)    visit(fun->body, param);
+        if (fun->args)    visit(fun->args, param);
+        /* The constants of the compiled body are not visited:
+         * they are roots keeping the data of the body alive. */
+        lenv_visit(fun->scope, visit, param);
+        break;
+        }
+    default: break;
+    }
+}
+
+/** lgc_target returns the tracked ldata of v or NULL. */
+static struct ldata* lgc_target(const struct lval* v) {
+    if (!lval_is_alive(v) || !v->data->tracked) {
+        return NULL;
+    }
+    return v->data;
+}
+
+static void lgc_subtract(const struct lval* v, void* param) {
+    (void)param;
+    struct ldata* d = lgc_target(v);
+    if (d) {
+        lgc_node(d)->refs--;
+    }
+}
+
+static void lgc_mark(const struct lval* v, void* param) {
+    struct ldata* d = lgc_target(v);
+    if (!d || lgc_node(d)->refs == LGC_REACHABLE) {
+        return;
+    }
+    lgc_node(d)->refs = LGC_REACHABLE;
+    ldata_visit(d, lgc_mark, param);
+}
+
+static long long lgc_time_ns(void) {
+    struct timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return tp.tv_sec * 1000000000LL + tp.tv_nsec;
+}
+
+size_t lval_gc_collect(void) {
+    long long stt = lgc_time_ns();
+    struct lgc_node* n = NULL;
+    #define foreach_tracked(n) \
+        for (n = lgc_heap.next; n != &lgc_heap; n = n->next)
+    /* References from the roots. */
+    foreach_tracked(n) {
+        n->refs = lgc_data(n)->refc;
+    }
+    foreach_tracked(n) {
+        ldata_visit(lgc_data(n), lgc_subtract, NULL);
+    }
+    /* Mark. */
+    foreach_tracked(n) {
+        if (n->refs > 0) {
+            n->refs = LGC_REACHABLE;
+            ldata_visit(lgc_data(n), lgc_mark, NULL);
+        }
+    }
+    /* Sweep: garbage is kept by one more reference while cycles are broken,
+     * so it is freed once, after all the references it holds are gone. */
+    size_t garbagec = 0;
+    foreach_tracked(n) {
+        if (n->refs != LGC_REACHABLE) {
+            garbagec++;
+        }
+    }
+    struct ldata** garbage = malloc(garbagec * sizeof(struct ldata*));
+    size_t g = 0;
+    foreach_tracked(n) {
+        if (n->refs != LGC_REACHABLE) {
+            lgc_data(n)->refc++;
+            garbage[g++] = lgc_data(n);
+        }
+    }
+    #undef foreach_tracked
+    for (g = 0; g < garbagec; g++) {
+        ldata_clear_payload(garbage[g]);
+    }
+    size_t reclaimed = 0;
+    for (g = 0; g < garbagec; g++) {
+        if (--garbage[g]->refc == 0) {
+            ldata_free(garbage[g]);
+            reclaimed++;
+        }
+    }
+    free(garbage);
+    long long pause = lgc_time_ns() - stt;
+    lgc_stats.collections++;
+    lgc_stats.reclaimed += reclaimed;
+    lgc_stats.pause_ns += pause;
+    if (pause > lgc_stats.max_pause_ns) {
+        lgc_stats.max_pause_ns = pause;
+    }
+    return reclaimed;
+}
+
+void lval_gc_safe_point(void) {
+    if (lgc_mode != LGC_TRACE || lgc_tracked < lgc_threshold) {
+        return;
+    }
+    lval_gc_collect();
+    lgc_threshold = 2 * lgc_tracked;
+    if (lgc_threshold < LGC_MIN_THRESHOLD) {
+        lgc_threshold = LGC_MIN_THRESHOLD;
+    }
 }
 
 struct lval* lval_alloc(void) {
-    struct lval* v = calloc(1, sizeof(struct lval));
+    enum lblock block = LBLOCK_HEAP;
+    struct lval* v = lalloc(&lval_pool, sizeof(struct lval), &block);
+    memset(v, 0, sizeof(struct lval));
+    v->block = block;
+    lalloc_handles++;
     /* Don't alloc data yet, let mutation functions do it. */
     lval_connect(v, &ldata_init);
-    v->ast = NULL;
+    v->ast = 0;
+    return v;
+}
+
+void lval_init(struct lval* v) {
+    v->data = NULL;
+    lval_connect(v, &ldata_init);
+    v->ast = 0;
+}
+
+void lval_release(struct lval* v) {
+    if (lval_is_alive(v)) {
+        lval_disconnect(v, false);
+    }
+}
+
+struct lval* lval_alloc_tmp(void) {
+    if (larena_top == larena_chunkc * LARENA_CHUNK) {
+        larena_chunks = realloc(larena_chunks,
+                (larena_chunkc+1) * sizeof(struct lval*));
+        larena_chunks[larena_chunkc++] =
+            malloc(LARENA_CHUNK * sizeof(struct lval));
+    }
+    struct lval* v = larena_slot(larena_top++);
+    lval_init(v);
+    v->block = LBLOCK_ARENA;
     return v;
 }
 
+size_t lval_arena_mark(void) {
+    return larena_top;
+}
+
+void lval_arena_release(size_t mark) {
+    while (larena_top > mark) {
+        struct lval* v = larena_slot(--larena_top);
+        if (v->data) {
+            lval_disconnect(v, false);
+        }
+    }
+}
+
 static struct lval* lval_alloc_handle(void) {
-    struct lval* v = calloc(1, sizeof(struct lval));
+    enum lblock block = LBLOCK_HEAP;
+    struct lval* v = lalloc(&lval_pool, sizeof(struct lval), &block);
+    memset(v, 0, sizeof(struct lval));
+    v->block = block;
+    lalloc_handles++;
     lval_kill(v);
     return v;
 }
@@ -254,20 +862,12 @@ bool lval_free(struct lval* v) {
         return false;
     }
     lval_disconnect(v, false);
-    free(v);
+    lfree(lval_pool, v, v->block);
     return true;
 }
 
 bool lval_clear(struct lval* v) {
-    if (!lval_is_mutable(v)) {
-        return false;
-    }
-    struct ldata* data = NULL;
-    if (!(data = lval_disconnect(v, true))) {
-        return false;
-    }
-    lval_connect(v, data);
-    return true;
+    return lval_mut_immediate(v, LVAL_NIL);
 }
 
 bool lval_dup(struct lval* dest, const struct lval* src) {
@@ -277,8 +877,17 @@ bool lval_dup(struct lval* dest, const struct lval* src) {
     if (dest == src) {
         return false;
     }
+    /* Immediate over immediate: no ldata to disconnect nor to count. */
+    struct ldata* imm = ldata_immediate(src->data->type);
+    if (imm && lval_is_alive(dest) && dest->data->mutable
+            && dest->data->alive == IMMORTAL) {
+        dest->data = imm;
+        dest->imm = src->imm;
+        dest->ast = src->ast;
+        return true;
+    }
     lval_disconnect(dest, false);
-    lval_connect(dest, src->data);
+    lval_link(dest, src);
     dest->ast = src->ast;
     return true;
 }
@@ -289,15 +898,10 @@ bool ldata_copy(struct ldata* dest, const struct ldata* src) {
     }
     switch (src->type) {
     case LVAL_NIL:
-        break;
     case LVAL_BOOL:
-        dest->payload.boolean = src->payload.boolean;
-        break;
     case LVAL_NUM:
-        dest->payload.num = src->payload.num;
-        break;
     case LVAL_DBL:
-        dest->payload.dbl = src->payload.dbl;
+        /* Immediate: the payload is in the handle. */
         break;
     case LVAL_ERR:
         dest->payload.err = lerr_alloc();
@@ -306,22 +910,27 @@ bool ldata_copy(struct ldata* dest, const struct ldata* src) {
     case LVAL_SEXPR:
     case LVAL_QEXPR:
         dest->payload.cell = calloc(src->len, sizeof(struct lval*));
+        dest->cap = src->len;
+        dest->head = 0;
         for (size_t c = 0; c < src->len; c++) {
             struct lval* val = lval_alloc_handle();
-            lval_connect(val, src->payload.cell[c]->data);
+            lval_link(val, src->payload.cell[c]);
             dest->payload.cell[c] = val;
         }
         break;
     case LVAL_BIGNUM:
         mpz_init_set(dest->payload.bignum, src->payload.bignum);
         break;
-    case LVAL_STR:
     case LVAL_SYM:
-        dest->payload.str = malloc(src->len+1);
-        if (!strncpy(dest->payload.str, src->payload.str, src->len+1)) {
-            free(dest->payload.str);
+        dest->payload.sym = src->payload.sym;
+        break;
+    case LVAL_STR:
+        dest->len = 0;
+        dest->payload.sso[0] = '\0';
+        ldata_str_reserve(dest, src->len);
+        if (ldata_str(src)) {
+            memcpy(ldata_str(dest), ldata_str(src), src->len+1);
         }
-        src->payload.str[src->len] = '\0';
         break;
     case LVAL_FUNC:
         dest->payload.func = lfunc_alloc();
@@ -346,6 +955,45 @@ static void lval_ensure_data_ownership(struct lval* v) {
     }
 }
 
+/** lval_transfer connects dest, which is not connected, to the data of src
+ ** without reference counting. src is left disconnected. */
+static INLINE void lval_transfer(struct lval* dest, struct lval* src) {
+    dest->data  = src->data;
+    dest->alive = src->alive;
+    dest->imm   = src->imm;
+    dest->ast   = src->ast;
+    src->data   = NULL;
+    src->alive  = DEAD;
+    src->ast    = 0;
+}
+
+/** lval_steal returns a handle which can be a cell of a list holding
+ ** the value of c. c is consumed. */
+static struct lval* lval_steal(struct lval* c) {
+    if (c->block != LBLOCK_ARENA) {
+        return c;
+    }
+    struct lval* handle = lval_alloc_handle();
+    lval_transfer(handle, c);
+    larena_pop();
+    return handle;
+}
+
+bool lval_move(struct lval* dest, struct lval* src) {
+    if (!dest || !lval_is_alive(src)) {
+        return false;
+    }
+    if (dest == src) {
+        return false;
+    }
+    if (dest->data) {
+        lval_disconnect(dest, false);
+    }
+    lval_transfer(dest, src);
+    lval_init(src);
+    return true;
+}
+
 bool lval_copy(struct lval* dest, const struct lval* src) {
     if (!lval_is_alive(src)) {
         return false;
@@ -353,53 +1001,296 @@ bool lval_copy(struct lval* dest, const struct lval* src) {
     if (!lval_is_mutable(dest)) {
         return false;
     }
-    if (!lval_clear(dest)) {
+    if (ldata_immediate(src->data->type)) {
+        if (dest != src) {
+            lval_disconnect(dest, false);
+            lval_link(dest, src);
+            dest->ast = src->ast;
+        }
+        return true;
+    }
+    struct ldata* data = NULL;
+    if (!(data = lval_disconnect(dest, true))) {
         return false;
     }
-    if (!ldata_copy(dest->data, src->data)) {
-        lval_connect(dest, dest->data);
+    if (!ldata_copy(data, src->data)) {
+        lval_connect(dest, data);
         return false;
     }
-    lval_connect(dest, dest->data);
+    lval_connect(dest, data);
     dest->ast = src->ast;
     return true;
 }
 
-bool lval_mut_nil(struct lval* v) {
-    if (!lval_is_mutable(v)) {
+/* Constants.
+ * A constant is an ldata interned by its content: for a list, the constants
+ * (or immediates) of its cells and their ast. The pool holds a reference on
+ * each constant (LCONST_REFC), so its refc stays above 1 while a handle is
+ * linked to it: such a handle can be mutated, it is given a new ldata, and
+ * the constant itself is always copied on write. A constant is dropped from
+ * the pool when its last handle (in an AST, a compiled code, an env...) is
+ * disconnected, but for symbols and builtins which are kept until
+ * lconst_release. Constants are never tracked by the cycle collector. */
+#define LCONST_CAPACITY 256
+
+static struct htable* lconst_table = NULL;
+static size_t lconst_count = 0;
+
+/** lconst_key is the key of a constant being built. */
+struct lconst_key {
+    char*  str;
+    size_t len;
+    size_t cap;
+};
+
+static void lconst_key_reserve(struct lconst_key* key, size_t len) {
+    if (key->len + len + 1 > key->cap) {
+        key->cap = 2 * (key->len + len + 1);
+        key->str = realloc(key->str, key->cap);
+    }
+}
+
+/** lconst_key_put appends the tag and the hexadecimal digits of x to key. */
+static void lconst_key_put(struct lconst_key* key, char tag, uint64_t x) {
+    lconst_key_reserve(key, 1 + 2*sizeof(x));
+    key->str[key->len++] = tag;
+    do {
+        key->str[key->len++] = "0123456789abcdef"[x & 0xf];
+        x >>= 4;
+    } while (x);
+    key->str[key->len] = '\0';
+}
+
+/** lconst_key_puts appends the tag and str to key. */
+static void lconst_key_puts(struct lconst_key* key, char tag, const char* str, size_t len) {
+    lconst_key_reserve(key, 1 + len);
+    key->str[key->len++] = tag;
+    memcpy(key->str + key->len, str, len);
+    key->len += len;
+    key->str[key->len] = '\0';
+}
+
+/** lconst_key_of builds the key of the constant equal to d.
+ ** It fails if d can't be frozen. */
+static bool lconst_key_of(const struct ldata* d, struct lconst_key* key) {
+    switch (d->type) {
+    case LVAL_STR:
+        {
+        const char* str = ldata_str(d);
+        lconst_key_puts(key, 's', (str) ? str : "", (str) ? d->len : 0);
+        return true;
+        }
+    case LVAL_SYM:
+        lconst_key_put(key, 'y', (uintptr_t)d->payload.sym);
+        return true;
+    case LVAL_BIGNUM:
+        {
+        char* digits = mpz_get_str(NULL, 16, d->payload.bignum);
+        lconst_key_puts(key, 'b', digits, strlen(digits));
+        free(digits);
+        return true;
+        }
+    case LVAL_SEXPR:
+    case LVAL_QEXPR:
+        lconst_key_put(key, (d->type == LVAL_SEXPR) ? 'e' : 'q', d->len);
+        for (size_t c = 0; c < d->len; c++) {
+            const struct lval* e = d->payload.cell[c];
+            if (ldata_immediate(e->data->type)) {
+                uint64_t bits = 0;
+                memcpy(&bits, &e->imm, sizeof(e->imm));
+                lconst_key_put(key, 'i', e->data->type);
+                lconst_key_put(key, ':', bits);
+            } else if (e->data->block == LBLOCK_CONST) {
+                lconst_key_put(key, 'p', (uintptr_t)e->data);
+            } else {
+                return false;
+            }
+            lconst_key_put(key, '@', e->ast);
+        }
+        return true;
+    default:
         return false;
     }
-    lval_clear(v); /* Default to nil, disconnect & connect. */
-    return true;
 }
 
-bool lval_mut_bool(struct lval* v, bool x) {
-    if (!lval_is_mutable(v)) {
+/** lconst is an entry of the pool of constants: the key follows the ldata. */
+struct lconst {
+    struct ldata data;
+    /** lconst.prev and lconst.next link the constants by order of creation:
+     ** lists after their cells. */
+    struct lconst* prev;
+    struct lconst* next;
+    uint64_t hash;
+    char key[];
+};
+
+/** lconst_last is the last created constant. */
+static struct lconst* lconst_last = NULL;
+
+/** lconst_alloc interns a copy of d under key. */
+static struct ldata* lconst_alloc(const struct ldata* d, const char* key, uint64_t hash) {
+    size_t len = strlen(key);
+    struct lconst* c = calloc(1, sizeof(struct lconst) + len+1);
+    memcpy(c->key, key, len+1);
+    c->hash = hash;
+    struct ldata* data = &c->data;
+    data->block = LBLOCK_CONST;
+    data->mutable = true;
+    if (d->type == LVAL_FUNC) {
+        /* The descriptor is adopted (see lval_mut_builtin). */
+        data->type = LVAL_FUNC;
+        data->len = 1;
+        data->payload.func = d->payload.func;
+    } else {
+        ldata_copy(data, d);
+    }
+    if (d->type == LVAL_SEXPR || d->type == LVAL_QEXPR) {
+        for (size_t e = 0; e < d->len; e++) {
+            data->payload.cell[e]->ast = d->payload.cell[e]->ast;
+        }
+    }
+    data->alive = lval_unique();
+    data->refc = LCONST_REFC;
+    /* Symbols and builtins are as many as the symbols, which are interned
+     * for good: they are kept by one more reference, not made again by
+     * each program. */
+    if (d->type == LVAL_SYM || d->type == LVAL_FUNC) {
+        data->refc++;
+    }
+    if (!lconst_table) {
+        lconst_table = ht_alloc(LCONST_CAPACITY);
+    }
+    bool insertion = false;
+    ht_insert(lconst_table, c->key, hash, c, NULL, &insertion);
+    c->prev = lconst_last;
+    if (lconst_last) {
+        lconst_last->next = c;
+    }
+    lconst_last = c;
+    lconst_count++;
+    return data;
+}
+
+/** lconst_drop removes the constant d from the pool and frees it.
+ ** The constants of its cells may be dropped in turn. */
+static void lconst_drop(struct ldata* d) {
+    struct lconst* c = (struct lconst*)d;
+    ht_remove(lconst_table, c->key, c->hash);
+    if (c->prev) {
+        c->prev->next = c->next;
+    }
+    if (c->next) {
+        c->next->prev = c->prev;
+    } else {
+        lconst_last = c->prev;
+    }
+    lconst_count--;
+    ldata_clear_payload(d);
+    free(c);
+}
+
+static void lconst_ignore(void* payload) {
+    (void)payload;
+}
+
+/** lconst_release frees the constants, lists before their cells. */
+static void lconst_release(void) {
+    while (lconst_last) {
+        lconst_drop(&lconst_last->data);
+    }
+    if (lconst_table) {
+        ht_free(lconst_table, lconst_ignore);
+        lconst_table = NULL;
+    }
+}
+
+bool lval_freeze(struct lval* v) {
+    if (!lval_is_alive(v)) {
         return false;
     }
-    struct ldata* data = NULL;
-    if (!(data = lval_disconnect(v, true))) {
+    if (ldata_immediate(v->data->type) || v->data->block == LBLOCK_CONST) {
+        return true;
+    }
+    /* Lists are frozen with their cells. */
+    if (v->data->type == LVAL_SEXPR || v->data->type == LVAL_QEXPR) {
+        for (size_t c = 0; c < v->data->len; c++) {
+            if (!lval_freeze(v->data->payload.cell[c])) {
+                return false;
+            }
+        }
+    }
+    struct lconst_key key = {0};
+    if (!lconst_key_of(v->data, &key)) {
+        free(key.str);
         return false;
     }
-    data->type = LVAL_BOOL;
-    data->payload.boolean = x;
-    data->len = 1;
+    uint64_t hash = ht_hash(key.str);
+    struct lconst* c = (lconst_table) ? ht_lookup(lconst_table, key.str, hash) : NULL;
+    struct ldata* data = (c) ? &c->data : lconst_alloc(v->data, key.str, hash);
+    free(key.str);
+    unsigned ast = v->ast;
+    lval_disconnect(v, false);
     lval_connect(v, data);
+    v->ast = ast;
     return true;
 }
 
-bool lval_mut_num(struct lval* v, long x) {
+bool lval_mut_builtin(struct lval* v, const struct lfunc* builtin, const char* symbol) {
+    if (!lval_is_mutable(v) || !builtin) {
+        return false;
+    }
+    const char* sym = lsym_intern((symbol) ? symbol : builtin->symbol);
+    struct lconst_key key = {0};
+    lconst_key_put(&key, 'f', (uintptr_t)builtin);
+    lconst_key_put(&key, 'y', (uintptr_t)sym);
+    uint64_t hash = ht_hash(key.str);
+    struct lconst* c = (lconst_table) ? ht_lookup(lconst_table, key.str, hash) : NULL;
+    struct ldata* data = (c) ? &c->data : NULL;
+    if (!data) {
+        struct ldata d = {.type = LVAL_FUNC, .len = 1};
+        if (!(d.payload.func = lfunc_alloc_builtin(builtin, sym))) {
+            free(key.str);
+            return false;
+        }
+        data = lconst_alloc(&d, key.str, hash);
+    }
+    free(key.str);
+    lval_disconnect(v, false);
+    lval_connect(v, data);
+    v->ast = 0;
+    return true;
+}
+
+size_t lval_const_count(void) {
+    return lconst_count;
+}
+
+bool lval_is_frozen(const struct lval* v) {
+    return lval_is_alive(v)
+        && (ldata_immediate(v->data->type) || v->data->block == LBLOCK_CONST);
+}
+
+bool lval_mut_nil(struct lval* v) {
     if (!lval_is_mutable(v)) {
         return false;
     }
-    struct ldata* data = NULL;
-    if (!(data = lval_disconnect(v, true))) {
+    lval_clear(v); /* Default to nil, disconnect & connect. */
+    return true;
+}
+
+bool lval_mut_bool(struct lval* v, bool x) {
+    if (!lval_mut_immediate(v, LVAL_BOOL)) {
         return false;
     }
-    data->type = LVAL_NUM;
-    data->payload.num = x;
-    data->len = 1;
-    lval_connect(v, data);
+    v->imm.boolean = x;
+    return true;
+}
+
+bool lval_mut_num(struct lval* v, long x) {
+    if (!lval_mut_immediate(v, LVAL_NUM)) {
+        return false;
+    }
+    v->imm.num = x;
     return true;
 }
 
@@ -407,6 +1298,9 @@ bool lval_mut_bignum(struct lval* v, const mpz_t x) {
     if (!lval_is_mutable(v)) {
         return false;
     }
+    if (mpz_fits_slong_p(x)) {
+        return lval_mut_num(v, mpz_get_si(x));
+    }
     struct ldata* data = NULL;
     if (!(data = lval_disconnect(v, true))) {
         return false;
@@ -418,18 +1312,45 @@ bool lval_mut_bignum(struct lval* v, const mpz_t x) {
     return true;
 }
 
-bool lval_mut_dbl(struct lval* v, double x) {
-    if (!lval_is_mutable(v)) {
+bool lval_mut_bignum_op(struct lval* v,
+        void (*op)(mpz_t r, const mpz_t a, const mpz_t b), const struct lval* x) {
+    if (!lval_is_mutable(v) || !lval_is_numeric(v) || !lval_is_numeric(x)) {
         return false;
     }
-    struct ldata* data = NULL;
-    if (!(data = lval_disconnect(v, true))) {
+    /* Read x without copy. */
+    mpz_t bx;
+    bool own_bx = x->data->type != LVAL_BIGNUM;
+    if (own_bx) {
+        mpz_init(bx);
+        lval_as_bignum(x, bx);
+    }
+    mpz_srcptr px = (own_bx) ? bx : x->data->payload.bignum;
+    struct ldata* d = v->data;
+    if (d->type == LVAL_BIGNUM && d->refc == 1 && d->alive != IMMORTAL) {
+        /* Update in place, then demote a value which fits in a long. */
+        op(d->payload.bignum, d->payload.bignum, px);
+        if (mpz_fits_slong_p(d->payload.bignum)) {
+            lval_mut_num(v, mpz_get_si(d->payload.bignum));
+        }
+    } else {
+        mpz_t r;
+        mpz_init(r);
+        lval_as_bignum(v, r);
+        op(r, r, px);
+        lval_mut_bignum(v, r);
+        mpz_clear(r);
+    }
+    if (own_bx) {
+        mpz_clear(bx);
+    }
+    return true;
+}
+
+bool lval_mut_dbl(struct lval* v, double x) {
+    if (!lval_mut_immediate(v, LVAL_DBL)) {
         return false;
     }
-    data->type = LVAL_DBL;
-    data->payload.dbl = x;
-    data->len = 1;
-    lval_connect(v, data);
+    v->imm.dbl = x;
     return true;
 }
 
@@ -486,20 +1407,17 @@ bool lval_mut_str(struct lval* v, const char* const str) {
     if (!lval_is_mutable(v) || !str) {
         return false;
     }
-    struct ldata* data = NULL;
-    if (!(data = lval_disconnect(v, true))) {
-        return false;
-    }
     size_t len = strlen(str);
-    if(!(data->payload.str = malloc(len+1))) {
-        free(data);
+    if (len > LDATA_MAX_LEN) {
         return false;
     }
-    if (!strncpy(data->payload.str, str, len+1)) {
-        free(data->payload.str);
-        free(data);
+    struct ldata* data = NULL;
+    if (!(data = lval_disconnect(v, true))) {
         return false;
     }
+    data->payload.sso[0] = '\0';
+    ldata_str_reserve(data, len);
+    memcpy(ldata_str(data), str, len+1);
     data->type = LVAL_STR;
     data->len = len;
     lval_connect(v, data);
@@ -507,10 +1425,17 @@ bool lval_mut_str(struct lval* v, const char* const str) {
 }
 
 bool lval_mut_sym(struct lval* v, const char* const sym) {
-    if (!lval_mut_str(v, sym)) {
+    if (!lval_is_mutable(v) || !sym) {
         return false;
     }
-    v->data->type = LVAL_SYM;
+    struct ldata* data = NULL;
+    if (!(data = lval_disconnect(v, true))) {
+        return false;
+    }
+    data->payload.sym = lsym_intern(sym);
+    data->type = LVAL_SYM;
+    data->len = lsym_len(data->payload.sym);
+    lval_connect(v, data);
     return true;
 }
 
@@ -572,7 +1497,43 @@ bool lval_mut_qexpr(struct lval* v) {
     return true;
 }
 
-bool lval_cons(struct lval* v, const struct lval* c) {
+/** ldata_str_insert adds the string c at the front or the back of d. */
+static bool ldata_str_insert(struct ldata* d, const struct ldata* c, bool front) {
+    size_t len_d = d->len;
+    size_t len_c = c->len;
+    if (!ldata_str_reserve(d, len_d+len_c)) {
+        return false;
+    }
+    char* str = ldata_str(d);
+    if (front) {
+        memmove(str+len_c, str, len_d+1);
+        memcpy(str, ldata_str(c), len_c);
+    } else {
+        memcpy(str+len_d, ldata_str(c), len_c);
+        str[len_d+len_c] = '\0';
+    }
+    d->len += len_c;
+    return true;
+}
+
+/** ldata_cells_insert adds handle at the front or the back of the cells of d. */
+static bool ldata_cells_insert(struct ldata* d, struct lval* handle, bool front) {
+    if (!ldata_cells_reserve(d, front)) {
+        return false;
+    }
+    if (front) {
+        d->payload.cell--;
+        d->head--;
+        d->payload.cell[0] = handle;
+    } else {
+        d->payload.cell[d->len] = handle;
+    }
+    d->len++;
+    return true;
+}
+
+/** lval_insert adds c at the front or the back of v. */
+static bool lval_insert(struct lval* v, const struct lval* c, bool front) {
     if (!lval_is_list(v) || !lval_is_alive(c)) {
         return false;
     }
@@ -583,62 +1544,56 @@ bool lval_cons(struct lval* v, const struct lval* c) {
         if (c->data->type != LVAL_STR) {
             return false;
         }
-        size_t len_v = v->data->len;
-        size_t len_c = c->data->len;
-        char** payload = &v->data->payload.str;
-        *payload = realloc(*payload, len_v+len_c+1);
-        memmove((*payload)+len_c, *payload, len_v);
-        memcpy(*payload, c->data->payload.str, len_c);
-        v->data->len += len_c;
-        *((*payload)+v->data->len) = '\0';
-        return true;
+        return ldata_str_insert(v->data, c->data, front);
     }
     /* Create a new handle. */
     struct lval* handle = lval_alloc_handle();
-    lval_connect(handle, c->data);
+    lval_link(handle, c);
     handle->ast = c->ast;
-    /* Add it to the list. */
-    v->data->payload.cell = realloc(v->data->payload.cell,
-            sizeof(struct lval*) * (v->data->len+1));
-    memmove(&v->data->payload.cell[1], &v->data->payload.cell[0],
-            sizeof(struct lval*) * (v->data->len));
-    v->data->payload.cell[0] = handle;
-    v->data->len++;
+    if (!ldata_cells_insert(v->data, handle, front)) {
+        lval_free(handle);
+        return false;
+    }
     return true;
 }
 
-bool lval_push(struct lval* v, const struct lval* c) {
-    if (!lval_is_list(v) || !lval_is_alive(c)) {
+/** lval_insert_move moves c at the front or the back of v. */
+static bool lval_insert_move(struct lval* v, struct lval* c, bool front) {
+    if (!lval_is_list(v) || !lval_is_alive(c) || c == v) {
         return false;
     }
-    /* Duplicate if multiple lval reference this data. */
-    lval_ensure_data_ownership(v);
-    /* Special case for strings. */
     if (v->data->type == LVAL_STR) {
-        if (c->data->type != LVAL_STR) {
+        if (!lval_insert(v, c, front)) {
             return false;
         }
-        size_t len_v = v->data->len;
-        size_t len_c = c->data->len;
-        char** payload = &v->data->payload.str;
-        *payload = realloc(*payload, len_v+len_c+1);
-        memcpy((*payload)+len_v, c->data->payload.str, len_c);
-        v->data->len += len_c;
-        *((*payload)+v->data->len) = '\0';
+        lval_free(c);
         return true;
     }
-    /* Create a new handle. */
-    struct lval* handle = lval_alloc_handle();
-    lval_connect(handle, c->data);
-    handle->ast = c->ast;
-    /* Add it to the list. */
-    v->data->payload.cell = realloc(v->data->payload.cell,
-            sizeof(struct lval*) * (v->data->len+1));
-    v->data->payload.cell[v->data->len] = handle;
-    v->data->len++;
+    lval_ensure_data_ownership(v);
+    /* Room is made first: c is only stolen once it can be inserted. */
+    if (!ldata_cells_reserve(v->data, front)) {
+        return false;
+    }
+    ldata_cells_insert(v->data, lval_steal(c), front);
     return true;
 }
 
+bool lval_cons(struct lval* v, const struct lval* c) {
+    return lval_insert(v, c, true);
+}
+
+bool lval_push(struct lval* v, const struct lval* c) {
+    return lval_insert(v, c, false);
+}
+
+bool lval_cons_move(struct lval* v, struct lval* c) {
+    return lval_insert_move(v, c, true);
+}
+
+bool lval_push_move(struct lval* v, struct lval* c) {
+    return lval_insert_move(v, c, false);
+}
+
 struct lval* lval_pop(struct lval* v, size_t c) {
     if (!lval_is_list(v)) {
         return false;
@@ -651,17 +1606,16 @@ struct lval* lval_pop(struct lval* v, size_t c) {
     /* Special case for strings. */
     if (v->data->type == LVAL_STR) {
         size_t len = v->data->len;
-        char** payload = &v->data->payload.str;
-        char popped = *(*payload + c);
-        memmove(*payload+c, *payload+c+1, len-1 - c);
-        if (len > 1) {
-            v->data->len--;
-            *payload = realloc(*payload, len);
-            *((*payload)+len-1) = '\0';
-        } else {
-            v->data->len = 0;
-            free(*payload);
-            *payload = NULL;
+        char* payload = ldata_str(v->data);
+        char popped = payload[c];
+        memmove(payload+c, payload+c+1, len - c); // With '\0'.
+        v->data->len--;
+        if (v->data->len == 0) {
+            if (v->data->cap > 0) {
+                free(v->data->payload.str);
+            }
+            v->data->payload.str = NULL;
+            v->data->cap = 1;
         }
         /* Create lval. */
         char str[2] = {0};
@@ -672,16 +1626,19 @@ struct lval* lval_pop(struct lval* v, size_t c) {
     }
     /* Pop the cell and return it. */
     struct lval* val = v->data->payload.cell[c];
-    memmove(&v->data->payload.cell[c], &v->data->payload.cell[c+1],
-            sizeof(struct lval*) * (v->data->len-1 - c));
-    if (v->data->len > 1) {
-        v->data->payload.cell = realloc(v->data->payload.cell,
-                sizeof(struct lval*) * (v->data->len-1));
+    /* Move the shortest side of the list. */
+    struct ldata* d = v->data;
+    if (c < d->len/2) {
+        memmove(&d->payload.cell[1], &d->payload.cell[0],
+                sizeof(struct lval*) * c);
+        d->payload.cell++;
+        d->head++;
     } else {
-        free(v->data->payload.cell);
-        v->data->payload.cell = NULL;
+        memmove(&d->payload.cell[c], &d->payload.cell[c+1],
+                sizeof(struct lval*) * (d->len-1 - c));
     }
-    v->data->len--;
+    d->len--;
+    ldata_cells_shrink(d);
     return val;
 }
 
@@ -710,22 +1667,20 @@ bool lval_index(const struct lval* v, size_t c, struct lval* dest) {
     /* Special case for strings. */
     if (v->data->type == LVAL_STR) {
         char str[2];
-        str[0] = *(v->data->payload.str+c);
+        str[0] = ldata_str(v->data)[c];
         str[1] = '\0';
-        struct ldata* data = lval_disconnect(dest, true);
-        lval_connect(dest, data);
         lval_mut_str(dest, &str[0]);
         return true;
     }
     lval_disconnect(dest, false);
     struct lval* e = v->data->payload.cell[c];
-    lval_connect(dest, e->data);
+    lval_link(dest, e);
     dest->ast = e->ast;
     return true;
 }
 
 const struct lval* lval_index_ptr(const struct lval* v, size_t c) {
-    if (lval_type(v) != LVAL_QEXPR) {
+    if (lval_type(v) != LVAL_QEXPR && lval_type(v) != LVAL_SEXPR) {
         return NULL;
     }
     if (c >= v->data->len) {
@@ -734,6 +1689,13 @@ const struct lval* lval_index_ptr(const struct lval* v, size_t c) {
     return v->data->payload.cell[c];
 }
 
+const struct lval* const* lval_cells(const struct lval* v) {
+    if (lval_type(v) != LVAL_QEXPR && lval_type(v) != LVAL_SEXPR) {
+        return NULL;
+    }
+    return (const struct lval* const*) v->data->payload.cell;
+}
+
 bool lval_mut_as(struct lval* dest, const struct lval* src) {
     if (!lval_is_alive(dest)) {
         return false;
@@ -764,20 +1726,23 @@ bool lval_mut_as(struct lval* dest, const struct lval* src) {
 }
 
 bool lval_alloc_range(struct lval* dest, size_t len) {
-    if (!lval_is_alive(dest)) {
+    if (!lval_is_alive(dest) || len > LDATA_MAX_LEN) {
         return false;
     }
+    if (lval_is_list(dest)) {
+        lval_ensure_data_ownership(dest);
+    }
     switch (lval_type(dest)) {
     case LVAL_STR:
-        if (dest->data->payload.str) {
-            free(dest->data->payload.str);
-        }
-        dest->data->payload.str = calloc(len+1, 1); // + '\0'.
+        ldata_str_reserve(dest->data, len);
+        memset(ldata_str(dest->data), 0, len+1); // + '\0'.
         dest->data->len = len;
         return true;
     case LVAL_SEXPR:
     case LVAL_QEXPR:
         dest->data->payload.cell = malloc(len * sizeof(struct lval*));
+        dest->data->cap = len;
+        dest->data->head = 0;
         for (size_t c = 0; c < len; c++) {
             dest->data->payload.cell[c] = lval_alloc();
         }
@@ -821,8 +1786,8 @@ bool lval_copy_range(
         len_range = len_dest - dfirst;
     }
     if (lval_type(src) == LVAL_STR) {
-        strncpy(dest->data->payload.str+dfirst, src->data->payload.str+sfirst, len_range);
-        dest->data->payload.str[len_dest] = '\0';
+        strncpy(ldata_str(dest->data)+dfirst, ldata_str(src->data)+sfirst, len_range);
+        ldata_str(dest->data)[len_dest] = '\0';
         return true;
     }
     size_t d = dfirst;
@@ -846,7 +1811,7 @@ bool lval_reverse(struct lval* dest, const struct lval* src) {
     if (lval_type(src) == LVAL_STR) {
         size_t s = len, d = 0;
         while (s > 0) {
-            dest->data->payload.str[d++] = src->data->payload.str[--s];
+            ldata_str(dest->data)[d++] = ldata_str(src->data)[--s];
         }
         return true;
     }
@@ -871,9 +1836,10 @@ bool lval_swap(struct lval* v, size_t i, size_t j) {
     lval_ensure_data_ownership(v);
     /* Swap. */
     if (v->data->type == LVAL_STR) {
-        char tmp = v->data->payload.str[i];
-        v->data->payload.str[i] = v->data->payload.str[j];
-        v->data->payload.str[j] = tmp;
+        char* str = ldata_str(v->data);
+        char tmp = str[i];
+        str[i] = str[j];
+        str[j] = tmp;
         return true;
     }
     struct lval* tmp = v->data->payload.cell[i];
@@ -899,7 +1865,7 @@ bool lval_sort(struct lval* v) {
     lval_ensure_data_ownership(v);
     /* Sort. */
     if (lval_type(v) == LVAL_STR) {
-        qsort(v->data->payload.str, v->data->len, 1, qsort_compare_char);
+        qsort(ldata_str(v->data), v->data->len, 1, qsort_compare_char);
         return true;
     }
     qsort(&v->data->payload.cell[0], v->data->len, sizeof(struct lval*),
@@ -958,7 +1924,7 @@ bool lval_as_bool(const struct lval* v) {
     if (!lval_is_alive(v) || lval_type(v) != LVAL_BOOL) {
         return false;
     }
-    return v->data->payload.boolean;
+    return v->imm.boolean;
 }
 
 bool lval_as_num(const struct lval* v, long* r) {
@@ -966,7 +1932,7 @@ bool lval_as_num(const struct lval* v, long* r) {
         *r = 0;
         return false;
     }
-    *r = v->data->payload.num;
+    *r = v->imm.num;
     return true;
 }
 
@@ -977,8 +1943,8 @@ bool lval_as_bignum(const struct lval* v, mpz_t r) {
     }
     /* Automatic casting */
     switch (v->data->type) {
-    case LVAL_DBL: mpz_set_d(r, v->data->payload.dbl); break;
-    case LVAL_NUM: mpz_set_si(r, v->data->payload.num); break;
+    case LVAL_DBL: mpz_set_d(r, v->imm.dbl); break;
+    case LVAL_NUM: mpz_set_si(r, v->imm.num); break;
     case LVAL_BIGNUM: mpz_set(r, v->data->payload.bignum); break;
     default: break;
     }
@@ -992,8 +1958,8 @@ bool lval_as_dbl(const struct lval* v, double* r) {
     }
     /* Automatic casting */
     switch (v->data->type) {
-    case LVAL_DBL: *r = v->data->payload.dbl; break;
-    case LVAL_NUM: *r = (double) v->data->payload.num; break;
+    case LVAL_DBL: *r = v->imm.dbl; break;
+    case LVAL_NUM: *r = (double) v->imm.num; break;
     /* No warranty. */
     case LVAL_BIGNUM: *r = mpz_get_d(v->data->payload.bignum); break;
     default: break;
@@ -1005,14 +1971,14 @@ const char* lval_as_str(const struct lval* v) {
     if (!lval_is_alive(v) || lval_type(v) != LVAL_STR) {
         return NULL;
     }
-    return v->data->payload.str;
+    return ldata_str(v->data);
 }
 
 const char* lval_as_sym(const struct lval* v) {
     if (!lval_is_alive(v) || lval_type(v) != LVAL_SYM) {
         return NULL;
     }
-    return v->data->payload.str;
+    return v->data->payload.sym;
 }
 
 struct lfunc* lval_as_func(const struct lval* v) {
@@ -1022,6 +1988,14 @@ struct lfunc* lval_as_func(const struct lval* v) {
     return v->data->payload.func;
 }
 
+const struct last* lval_ast(const struct lval* v) {
+    return (v) ? last_from_id(v->ast) : NULL;
+}
+
+void lval_set_ast(struct lval* v, const struct last* ast) {
+    v->ast = last_id(ast);
+}
+
 bool lval_is_nil(const struct lval* v) {
     return !lval_is_alive(v) || v->data->type == LVAL_NIL;
 }
@@ -1042,8 +2016,8 @@ bool lval_is_zero(const struct lval* v) {
     static mpz_t zero;
     mpz_init_set_si(zero, 0);
     switch (v->data->type) {
-    case LVAL_NUM:    return v->data->payload.num == 0;
-    case LVAL_DBL:    return fpclassify(v->data->payload.dbl) == FP_ZERO;
+    case LVAL_NUM:    return v->imm.num == 0;
+    case LVAL_DBL:    return fpclassify(v->imm.dbl) == FP_ZERO;
     case LVAL_BIGNUM: return mpz_cmp(v->data->payload.bignum, zero) == 0;
     default:          return false;
     };
@@ -1054,8 +2028,8 @@ int lval_sign(const struct lval* v) {
         return 0;
     }
     switch (v->data->type) {
-    case LVAL_NUM:    return (v->data->payload.num > 0) - (v->data->payload.num < 0);
-    case LVAL_DBL:    return (v->data->payload.dbl > .0) - (v->data->payload.dbl < .0);
+    case LVAL_NUM:    return (v->imm.num > 0) - (v->imm.num < 0);
+    case LVAL_DBL:    return (v->imm.dbl > .0) - (v->imm.dbl < .0);
     case LVAL_BIGNUM: return mpz_sgn(v->data->payload.bignum);
     default:          return 0;
     };
@@ -1069,24 +2043,24 @@ bool lval_is_list(const struct lval* v) {
 bool lval_are_equal(const struct lval* x, const struct lval* y) {
     if (!lval_is_alive(x))              return false;
     if (!lval_is_alive(y))              return false;
-    if (x->data == y->data)             return true;
     if (x->data->type != y->data->type) return false;
+    if (x->data == y->data && !ldata_immediate(x->data->type)) return true;
     if (x->data->len != y->data->len)   return false;
     static const double epsilon = 0.000001;
     switch (x->data->type) {
     case LVAL_NIL:    return x->data->type == y->data->type;
-    case LVAL_BOOL:   return x->data->payload.boolean == y->data->payload.boolean;
+    case LVAL_BOOL:   return x->imm.boolean == y->imm.boolean;
     case LVAL_ERR:
         {
         struct lerr* cause_x = lerr_cause(x->data->payload.err);
         struct lerr* cause_y = lerr_cause(y->data->payload.err);
         return cause_x->code == cause_y->code;
         }
-    case LVAL_NUM:    return x->data->payload.num == y->data->payload.num;
+    case LVAL_NUM:    return x->imm.num == y->imm.num;
     case LVAL_BIGNUM: return mpz_cmp(x->data->payload.bignum, y->data->payload.bignum) == 0;
-    case LVAL_DBL:    return fabs(x->data->payload.dbl - y->data->payload.dbl) < epsilon;
-    case LVAL_SYM:
-    case LVAL_STR:    return strcmp(x->data->payload.str, y->data->payload.str) == 0;
+    case LVAL_DBL:    return fabs(x->imm.dbl - y->imm.dbl) < epsilon;
+    case LVAL_SYM:    return x->data->payload.sym == y->data->payload.sym;
+    case LVAL_STR:    return strcmp(ldata_str(x->data), ldata_str(y->data)) == 0;
     case LVAL_SEXPR:
     case LVAL_QEXPR:
         for (size_t c = 0; c < x->data->len; c++) {
@@ -1103,28 +2077,36 @@ bool lval_are_equal(const struct lval* x, const struct lval* y) {
 
 #define payload(x) (x->data->payload)
 #define compare(x,y) ((x > y) - (x < y))
-#define compare_payload(x,y,m) compare(payload(x).m, payload(y).m)
+#define compare_imm(x,y,m) compare(x->imm.m, y->imm.m)
 
 int lval_compare(const struct lval* x, const struct lval* y) {
     if (!lval_is_alive(x))              return -1;
     if (!lval_is_alive(y))              return -1;
-    if (x->data == y->data)             return 0;
+    /* A bignum doesn't fit in a long, its sign tells the order. */
+    if (x->data->type == LVAL_NUM && y->data->type == LVAL_BIGNUM) {
+        return -mpz_sgn(payload(y).bignum);
+    }
+    if (x->data->type == LVAL_BIGNUM && y->data->type == LVAL_NUM) {
+        return mpz_sgn(payload(x).bignum);
+    }
     if (x->data->type != y->data->type) return -1;
+    if (x->data == y->data && !ldata_immediate(x->data->type)) return 0;
     if (x->data->len != y->data->len)   return -1;
     switch (x->data->type) {
     case LVAL_NIL:
         return 0;
     case LVAL_BOOL:
-        return compare_payload(x, y, boolean);
+        return compare_imm(x, y, boolean);
     case LVAL_NUM:
-        return compare_payload(x, y, num);
+        return compare_imm(x, y, num);
     case LVAL_DBL:
-        return compare_payload(x, y, dbl);
+        return compare_imm(x, y, dbl);
     case LVAL_BIGNUM:
         return mpz_cmp(payload(x).bignum, payload(y).bignum);
     case LVAL_STR:
+        return strcmp(ldata_str(x->data), ldata_str(y->data));
     case LVAL_SYM:
-        return strcmp(payload(x).str, payload(y).str);
+        return strcmp(payload(x).sym, payload(y).sym);
     case LVAL_FUNC:
     case LVAL_ERR:
         return lval_are_equal(x, y);
@@ -1160,7 +2142,7 @@ static void lval_debug(const struct lval* v, FILE* out, bool recursive, int inde
             v->data, v->alive);
     INDENT(out, indent);
     fprintf(out,
-            "  ldata{type: %s, len: %ld, alive: 0x%x, refc: %d, mutable: %s,\n",
+            "  ldata{type: %s, len: %u, alive: 0x%x, refc: %u, mutable: %s,\n",
             lval_type_string(lval_type(v)), v->data->len, v->data->alive, v->data->refc,
             v->data->mutable ? "true" : "false");
     INDENT(out, indent);
@@ -1211,30 +2193,31 @@ void lval_print_to(const struct lval* v, FILE* out) {
         fprintf(out, "nil");
         break;
     case LVAL_BOOL:
-        fprintf(out, (v->data->payload.boolean) ? "true" : "false");
+        fprintf(out, (v->imm.boolean) ? "true" : "false");
         break;
     case LVAL_NUM:
-        fprintf(out, "%li", v->data->payload.num);
+        fprintf(out, "%li", v->imm.num);
         break;
     case LVAL_BIGNUM:
         {
+        /* Room for the sign and the terminating null byte. */
         size_t len = mpz_sizeinbase(v->data->payload.bignum, 10);
-        char* buffer = malloc(len+1);
+        char* buffer = malloc(len+2);
         mpz_get_str(buffer, 10, v->data->payload.bignum);
         fputs(buffer, out);
         free(buffer);
         break;
         }
     case LVAL_DBL:
-        fprintf(out, "%g", v->data->payload.dbl);
+        fprintf(out, "%g", v->imm.dbl);
         break;
     case LVAL_SYM:
-        fputs(v->data->payload.str, out);
+        fputs(v->data->payload.sym, out);
         break;
     case LVAL_STR:
         fputc('"', out);
-        if (v->data->payload.str) {
-            fputs(v->data->payload.str, out);
+        if (ldata_str(v->data)) {
+            fputs(ldata_str(v->data), out);
         }
         fputc('"', out);
         break;
@@ -4,7 +4,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 
-#include "vendor/mini-gmp/mini-gmp.h"
+#include "lgmp.h"
 
 #include "lerr.h"
 
@@ -31,11 +31,21 @@ struct lfunc;
 struct lval {
     /** lval.alive is a code used to detect aliveness of the payload. */
     int alive;
+    /** lval.ast is the id of the corresponding ast node, 0 if none.
+     ** For error handling, see lval_ast. Ids are copied between handles as is. */
+    unsigned ast : 30;
+    /** lval.block tells the allocator where the handle comes from. */
+    unsigned block : 2;
     /** lval.data is a pointer to the actual ldata. */
     struct ldata* data;
-    /** lval.ast is a pointer to the corresponding ast node. For error handling.
-     ** Must not be used after the corresponding ast had been cleaned. */
-    const struct last* ast;
+    /** lval.imm is the payload of a LVAL_NIL, LVAL_BOOL, LVAL_NUM or LVAL_DBL:
+     ** these values are immediate, they live inline in the handle and
+     ** lval.data only points to a static ldata giving their type. */
+    union {
+        bool   boolean;
+        long   num;
+        double dbl;
+    } imm;
 };
 
 /* Special lvals used in builtins. */
@@ -44,13 +54,94 @@ extern const struct lval lzero;   /** = 0   */
 extern const struct lval lone;    /** = 1   */
 extern const struct lval lemptyq; /** = {}  */
 
+/* Allocator */
+/** lalloc_mode tells how lval handles and their ldata are allocated. */
+enum lalloc_mode {
+    LALLOC_MALLOC = 0, /* Heap allocation (default). */
+    LALLOC_POOL,       /* Allocation from memory pools (generic/mempool). */
+};
+/** lval_set_alloc_mode selects the allocator used by subsequent allocations.
+ ** Blocks already allocated are reclaimed by the allocator that created them. */
+void lval_set_alloc_mode(enum lalloc_mode mode);
+/** lval_alloc_mode returns the allocator currently in use. */
+enum lalloc_mode lval_alloc_mode(void);
+/** lval_alloc_release frees the memory pools and the constants.
+ ** It fails if a pooled lval or ldata is still alive.
+ ** No handle may be linked to a constant anymore (see lval_freeze). */
+bool lval_alloc_release(void);
+/** lval_alloc_count gives the number of handles and of ldata allocated so far. */
+void lval_alloc_count(size_t* handles, size_t* data);
+/** lval_alloc_sizes gives the size in bytes of a handle and of a ldata. */
+void lval_alloc_sizes(size_t* handle, size_t* data);
+
+/* Collector */
+/** lgc_mode tells how unreachable ldata are reclaimed. */
+enum lgc_mode {
+    LGC_REFC = 0, /* Reference counting only (default): cycles leak. */
+    LGC_TRACE,    /* Reference counting and a cycle collector (lval_gc_collect). */
+};
+/** lgc_stats are the statistics of the cycle collector. */
+struct lgc_stats {
+    size_t collections;    /* Number of collections. */
+    size_t reclaimed;      /* Number of ldata reclaimed. */
+    long long pause_ns;    /* Total time spent collecting. */
+    long long max_pause_ns;
+};
+/** lval_set_gc_mode selects the collector for subsequent allocations.
+ ** Only the ldata allocated in mode LGC_TRACE are collected. */
+void lval_set_gc_mode(enum lgc_mode mode);
+/** lval_gc_mode returns the collector currently in use. */
+enum lgc_mode lval_gc_mode(void);
+/** lval_gc_collect reclaims the cycles of ldata no longer referenced from
+ ** outside the collected ldata: env, VM stack and handles held by callers
+ ** are the roots. It returns the number of ldata reclaimed. */
+size_t lval_gc_collect(void);
+/** lval_gc_safe_point collects once enough ldata were allocated since
+ ** the last collection. It must only be called between two operations. */
+void lval_gc_safe_point(void);
+/** lval_gc_stats gives the statistics of the collector since the start. */
+void lval_gc_stats(struct lgc_stats* stats);
+
+/* Constants */
+/** lval_freeze turns v into a constant: its ldata is interned into the pool
+ ** of constants and shared by all the equal constants. A handle linked to a
+ ** constant stays mutable, it gets its own copy of the ldata first.
+ ** Strings, bignums, symbols and lists of constants can be frozen;
+ ** immediates are already shared. A constant is freed with its last handle,
+ ** symbols are kept until lval_alloc_release. */
+bool lval_freeze(struct lval* v);
+/** lval_mut_builtin links v to the constant function of the builtin named
+ ** symbol (its own symbol if NULL), shared by all the environments: once
+ ** created, it is linked without any allocation (see lfunc_alloc_builtin). */
+bool lval_mut_builtin(struct lval* v, const struct lfunc* builtin, const char* symbol);
+/** lval_const_count returns the number of constants in the pool. */
+size_t lval_const_count(void);
+/** lval_is_frozen tells if v is linked to a constant or is an immediate. */
+bool lval_is_frozen(const struct lval* v);
+
 /* Constructor & Destructor */
 /** lval_alloc returns a handle to a new lval of type LVAL_NIL.
  ** Caller is responsible for calling lval_free. */
 struct lval* lval_alloc(void);
+/** lval_alloc_tmp returns a handle to a new lval of type LVAL_NIL allocated
+ ** from the arena of temporary handles. The memory of the handle is reused
+ ** once the handles allocated after it are freed too: it must be a scratch
+ ** handle, freed by lval_free or lval_arena_release. */
+struct lval* lval_alloc_tmp(void);
+/** lval_arena_mark returns the current top of the arena of temporary handles. */
+size_t lval_arena_mark(void);
+/** lval_arena_release frees the temporary handles allocated since mark. */
+void lval_arena_release(size_t mark);
 /** lval_free reclaims v internal memory.
  ** v must not be used afterwards. */
 bool lval_free(struct lval* v);
+/** lval_init initializes the handle v embedded into another structure
+ ** to a lval of type LVAL_NIL. v is not allocated by lval_alloc:
+ ** caller is responsible for calling lval_release, not lval_free. */
+void lval_init(struct lval* v);
+/** lval_release disconnects the embedded handle v from its data.
+ ** v must not be used afterwards, except by lval_init. */
+void lval_release(struct lval* v);
 
 /* Memory management */
 /** lval_clear mutates v to LVAL_NIL.
@@ -62,6 +153,10 @@ bool lval_clear(struct lval* v);
 bool lval_dup(struct lval* dest, const struct lval* src);
 /** lval_copy does a deep copy of src into dest. */
 bool lval_copy(struct lval* dest, const struct lval* src);
+/** lval_move moves the data of src into dest, src becomes nil.
+ ** Unlike lval_dup, no reference count is updated.
+ ** lval_move fails when dest == src. */
+bool lval_move(struct lval* dest, struct lval* src);
 
 /* Mutators */
 /** lval_mut_nil mutates v to LVAL_NIL type. */
@@ -70,8 +165,15 @@ bool lval_mut_nil(struct lval* v);
 bool lval_mut_bool(struct lval* v, bool x);
 /** lval_mut_num mutates v to LVAL_NUM type. */
 bool lval_mut_num(struct lval* v, long x);
-/** lval_mut_bignum mutates v to LVAL_BIGNUM type. x is copied. */
+/** lval_mut_bignum mutates v to LVAL_BIGNUM type. x is copied.
+ ** v is mutated to LVAL_NUM when x fits in a long. */
 bool lval_mut_bignum(struct lval* v, const mpz_t x);
+/** lval_mut_bignum_op mutates v to the bignum op(v, x).
+ ** When v is a bignum whose data is held by v only, its bignum is updated
+ ** in place, a bignum x is read without copy.
+ ** op must accept its result to be one of its operands. */
+bool lval_mut_bignum_op(struct lval* v,
+        void (*op)(mpz_t r, const mpz_t a, const mpz_t b), const struct lval* x);
 /** lval_mut_dbl mutates v to LVAL_DBL type. */
 bool lval_mut_dbl(struct lval* v, double x);
 /** lval_mut_err_code mutates v to LVAL_ERR type. */
@@ -100,16 +202,28 @@ bool lval_cons(struct lval* v, const struct lval* cell);
 /** lval_push add cell to v. v must be of type sexpr or qexpr.
  ** cell is safe to be freed by the caller after. */
 bool lval_push(struct lval* v, const struct lval* cell);
+/** lval_cons_move adds cell at the beginning of v, cell is moved into v:
+ ** a handle allocated by lval_alloc becomes the cell of v, the value of a
+ ** handle allocated by lval_alloc_tmp is moved into a new cell.
+ ** No reference count is updated. cell must not be used afterwards,
+ ** unless lval_cons_move fails. */
+bool lval_cons_move(struct lval* v, struct lval* cell);
+/** lval_push_move adds cell to v, cell is moved into v (see lval_cons_move). */
+bool lval_push_move(struct lval* v, struct lval* cell);
 /** lval_pop remove cell c from v and returns it.
+ ** The handle of the cell is moved out of v, no reference count is updated.
  ** Caller is responsible for calling free on returned value. */
 struct lval* lval_pop(struct lval* v, size_t c);
 /** lval_drop pops cell c from v then discards it. */
 bool lval_drop(struct lval* v, size_t c);
 /** lval_index returns the c-th child of a {s,q}expr in dest. */
 bool lval_index(const struct lval* v, size_t c, struct lval* dest);
-/** lval_index_ptr returns a pointer to the c-th element of v. v must be a qexpr.
+/** lval_index_ptr returns a pointer to the c-th element of v. v must be a qexpr or a sexpr.
  ** The pointer stays valid until v is freed or mutated. */
 const struct lval* lval_index_ptr(const struct lval* v, size_t c);
+/** lval_cells returns the elements of v as an array of lval_len(v) pointers,
+ ** NULL if v is not a qexpr nor a sexpr. It stays valid like lval_index_ptr. */
+const struct lval* const* lval_cells(const struct lval* v);
 /** lval_alloc_range allocates a list of len len in dest. */
 bool lval_alloc_range(struct lval* dest, size_t len);
 /** lval_copy_range copies a range from src to dest. */
@@ -159,6 +273,10 @@ const char* lval_as_sym(const struct lval* v);
  ** The pointed value is NOT a copy of the symbol.
  ** The pointer stays valid while v is alive. */
 struct lfunc* lval_as_func(const struct lval* v);
+/** lval_ast returns the ast node v comes from, NULL if none or freed. */
+const struct last* lval_ast(const struct lval* v);
+/** lval_set_ast sets the ast node v comes from. */
+void lval_set_ast(struct lval* v, const struct last* ast);
 
 /* Inquiries */
 /** lval_is_nil returns true if v is nil. */
@@ -174,7 +292,7 @@ int lval_sign(const struct lval* v);
 bool lval_is_list(const struct lval* v);
 /** lval_are_equal returns true if x and y data are equal. */
 bool lval_are_equal(const struct lval* x, const struct lval* y);
-/** lval_compare compares x to y.
+/** lval_compare compares x to y, a num is compared to a bignum by value.
  ** lval_compare returns:
  **   <0 if x < y
  **   =0 if x == y
@@ -0,0 +1,260 @@
+#include "lval.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "lenv.h"
+#include "leval.h"
+
+#define BENCHMARK_IMPL
+#include "benchmark.h"
+
+#ifndef RUNS
+#define RUNS 100000
+#endif
+
+/* map & fold allocate several handles per element. */
+static const char* workload =
+    "fold + 0 (map (\\ {x} {* x 2}) (seq 1 1000))";
+
+static void benchmark_workload(enum lalloc_mode mode, const char* name, size_t runs) {
+    benchmark_display_banner(name, runs, workload);
+    lval_set_alloc_mode(mode);
+    struct lenv* env = lenv_alloc();
+    lenv_default(env);
+    struct lval* r = lval_alloc();
+    long long stt = benchmark_get_time_ns();
+    for (size_t run = 0; run < runs; run++) {
+        struct lerr* err = leval_from_string(env, workload, r);
+        assert(err == NULL);
+    }
+    long long end = benchmark_get_time_ns();
+    long sum = 0;
+    assert(lval_as_num(r, &sum) && sum == 1001000);
+    lval_free(r);
+    lenv_free(env);
+    /* Released outside of assert, which may be compiled out. */
+    bool released = lval_alloc_release();
+    assert(released);
+    (void)released;
+    benchmark_display_results(stt, end, runs);
+}
+
+/* Handles and their data allocated then freed by batches, without any
+ * evaluation: the cost of the allocator alone. */
+#define CHURN_BATCH 1000
+
+static void benchmark_churn(enum lalloc_mode mode, const char* name, size_t runs) {
+    benchmark_display_banner(name, runs, "alloc & free 1000 lists");
+    lval_set_alloc_mode(mode);
+    struct lval* batch[CHURN_BATCH];
+    long long stt = benchmark_get_time_ns();
+    for (size_t run = 0; run < runs; run++) {
+        for (size_t b = 0; b < CHURN_BATCH; b++) {
+            batch[b] = lval_alloc();
+            lval_mut_qexpr(batch[b]);
+        }
+        for (size_t b = 0; b < CHURN_BATCH; b++) {
+            lval_free(batch[b]);
+        }
+    }
+    long long end = benchmark_get_time_ns();
+    lval_set_alloc_mode(LALLOC_MALLOC);
+    bool released = lval_alloc_release();
+    assert(released);
+    (void)released;
+    benchmark_display_results(stt, end, runs);
+}
+
+/* The workload plus cyclic lists, only reclaimed by the collector. */
+static void benchmark_collector(enum lgc_mode mode, const char* name, size_t runs) {
+    benchmark_display_banner(name, runs, workload);
+    lval_set_gc_mode(mode);
+    struct lgc_stats before;
+    lval_gc_stats(&before);
+    struct lenv* env = lenv_alloc();
+    lenv_default(env);
+    struct lval* r = lval_alloc();
+    long long stt = benchmark_get_time_ns();
+    for (size_t run = 0; run < runs; run++) {
+        struct lerr* err = leval_from_string(env, workload, r);
+        assert(err == NULL);
+        for (size_t c = 0; c < 1000; c++) {
+            struct lval* cycle = lval_alloc();
+            lval_mut_qexpr(cycle);
+            lval_push(cycle, r);
+            lval_push(cycle, cycle);
+            lval_free(cycle);
+        }
+    }
+    long long end = benchmark_get_time_ns();
+    lval_free(r);
+    lenv_free(env);
+    struct lgc_stats after;
+    lval_gc_stats(&after);
+    size_t collections = after.collections - before.collections;
+    long long pause = after.pause_ns - before.pause_ns;
+    fprintf(stdout, "  Collections: %zu, Reclaimed: %zu, Pause: %.3lf ms (max %.3lf ms)\n",
+            collections, after.reclaimed - before.reclaimed,
+            pause / 1e6, after.max_pause_ns / 1e6);
+    lval_set_gc_mode(LGC_REFC);
+    benchmark_display_results(stt, end, runs);
+}
+
+/* Lists built at both ends then emptied from the front. */
+static void benchmark_list(const char* name, size_t runs, size_t len) {
+    char infos[64];
+    snprintf(infos, sizeof(infos), "push, cons & pop %zu elements", len);
+    benchmark_display_banner(name, runs, infos);
+    struct lval* x = lval_alloc();
+    struct lval* list = lval_alloc();
+    long long stt = benchmark_get_time_ns();
+    for (size_t run = 0; run < runs; run++) {
+        lval_mut_qexpr(list);
+        for (size_t e = 0; e < len; e++) {
+            lval_mut_num(x, e);
+            lval_push(list, x);
+            lval_cons(list, x);
+        }
+        while (lval_len(list) > 0) {
+            lval_drop(list, 0);
+        }
+    }
+    long long end = benchmark_get_time_ns();
+    lval_free(list);
+    lval_free(x);
+    benchmark_display_results(stt, end, runs);
+}
+
+/* Allocations made by a reduction over a long list of numbers. */
+static const char* reduce_workload = "fold + 0 (seq 1 1000000)";
+
+/* Lists built by map and by the evaluation of their elements. */
+static const char* build_workload =
+    "len (map (\\ {x} {list x (+ x 1)}) (seq 1 100000))";
+
+/* A long list literal, every element is read into a handle. */
+static const char* read_info = "len {(+ 1 2) (+ 1 2) ...}";
+static const char* read_cell = "(+ 1 2) ";
+#define READ_LEN 100000
+
+static char* read_workload_alloc(void) {
+    size_t cell = strlen(read_cell);
+    char* workload = malloc(READ_LEN * cell + sizeof("len {}"));
+    char* w = workload;
+    w += sprintf(w, "len {");
+    for (size_t c = 0; c < READ_LEN; c++) {
+        memcpy(w, read_cell, cell);
+        w += cell;
+    }
+    sprintf(w, "}");
+    return workload;
+}
+
+static void benchmark_allocations(const char* name, const char* info,
+        const char* workload, long expected) {
+    benchmark_display_banner(name, 1, info);
+    struct lenv* env = lenv_alloc();
+    lenv_default(env);
+    struct lval* r = lval_alloc();
+    size_t handles = 0, data = 0;
+    lval_alloc_count(&handles, &data);
+    long long stt = benchmark_get_time_ns();
+    struct lerr* err = leval_from_string(env, workload, r);
+    assert(err == NULL);
+    long long end = benchmark_get_time_ns();
+    size_t handles_end = 0, data_end = 0;
+    lval_alloc_count(&handles_end, &data_end);
+    long x = 0;
+    assert(lval_as_num(r, &x) && x == expected);
+    lval_free(r);
+    lenv_free(env);
+    fprintf(stdout, "  Allocations: %zu handles, %zu ldata\n",
+            handles_end - handles, data_end - data);
+    benchmark_display_results(stt, end, 1);
+}
+
+/* Number of elements of the footprint workloads. */
+#define FOOTPRINT_LEN 1000000
+
+/* Short strings built one by one and held in a list. */
+static const char* strings_workload =
+    "def {words} (map (\\ {x} {join \"sym\" \"bol\"}) (seq 1 1000000))";
+
+/** max_rss_kb returns the peak resident set size of the process. */
+static long max_rss_kb(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/* One million elements, each one a list holding a number. */
+static const char* nested_workload =
+    "def {nested} (map (\\ {x} {list x}) (seq 1 1000000))";
+
+/** benchmark_footprint runs workload into a child process:
+ ** the peak RSS only grows, each workload starts from a fresh one. */
+static void benchmark_footprint(const char* name, const char* workload) {
+    benchmark_display_banner(name, 1, workload);
+    fflush(stdout);
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid > 0) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS);
+        return;
+    }
+    struct lenv* env = lenv_alloc();
+    lenv_default(env);
+    struct lval* r = lval_alloc();
+    long rss = max_rss_kb();
+    long long stt = benchmark_get_time_ns();
+    struct lerr* err = leval_from_string(env, workload, r);
+    assert(err == NULL);
+    long long end = benchmark_get_time_ns();
+    long growth = max_rss_kb() - rss;
+    size_t handle = 0, data = 0;
+    lval_alloc_sizes(&handle, &data);
+    /* Before the packed layout: 32-byte handles and 88-byte ldata. */
+    fprintf(stdout, "  Layout: %zu B handle, %zu B ldata (was 32 B, 88 B)\n",
+            handle, data);
+    fprintf(stdout, "  Peak RSS growth: %ld kB, %ld B per element\n",
+            growth, growth * 1024 / FOOTPRINT_LEN);
+    lval_free(r);
+    lenv_free(env);
+    benchmark_display_results(stt, end, 1);
+    exit(EXIT_SUCCESS);
+}
+
+int main(void)
+{
+    size_t runs = RUNS / 10000;
+    if (runs == 0) {
+        runs = 1;
+    }
+    benchmark_footprint("lval/footprint", strings_workload);
+    benchmark_footprint("lval/footprint/nested", nested_workload);
+    benchmark_workload(LALLOC_MALLOC, "lval/malloc", runs);
+    benchmark_workload(LALLOC_POOL, "lval/pool", runs);
+    benchmark_churn(LALLOC_MALLOC, "lval/churn/malloc", runs);
+    benchmark_churn(LALLOC_POOL, "lval/churn/pool", runs);
+    benchmark_list("lval/list", runs, 100000);
+    benchmark_collector(LGC_REFC, "lval/refc", runs);
+    benchmark_collector(LGC_TRACE, "lval/trace", runs);
+    benchmark_allocations("lval/allocations",
+            reduce_workload, reduce_workload, 500000500000);
+    benchmark_allocations("lval/allocations/build",
+            build_workload, build_workload, 100000);
+    char* read_workload = read_workload_alloc();
+    benchmark_allocations("lval/allocations/read",
+            read_info, read_workload, READ_LEN);
+    free(read_workload);
+    return EXIT_SUCCESS;
+}
@@ -2,6 +2,7 @@
 
 #include "lval.h"
 
+#include <limits.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -9,7 +10,7 @@
 
 #include "lbuiltin_test.h"
 
-#include "vendor/mini-gmp/mini-gmp.h"
+#include "lgmp.h"
 #include "vendor/snow/snow/snow.h"
 
 #define LENGTH(array) sizeof(array)/sizeof(array[0])
@@ -29,6 +30,150 @@ describe(lval, {
         assert(lval_free(v));
     });
 
+    it("allocates a lval from the pools and frees it", {
+        lval_set_alloc_mode(LALLOC_POOL);
+        defer(lval_set_alloc_mode(LALLOC_MALLOC));
+        struct lval* v = lval_alloc();
+        assert(lval_mut_num(v, 10));
+        struct lval* l = lval_alloc();
+        assert(lval_mut_qexpr(l));
+        assert(lval_push(l, v));
+        bool released = lval_alloc_release();
+        assert(!released);
+        assert(lval_free(v));
+        assert(lval_free(l));
+        released = lval_alloc_release();
+        assert(released);
+    });
+
+    it("frees a lval allocated by another allocator", {
+        struct lval* v = lval_alloc();
+        assert(lval_mut_num(v, 10));
+        lval_set_alloc_mode(LALLOC_POOL);
+        defer(lval_set_alloc_mode(LALLOC_MALLOC));
+        struct lval* w = lval_alloc();
+        assert(lval_dup(w, v));
+        assert(lval_free(v));
+        assert(lval_free(w));
+        bool released = lval_alloc_release();
+        assert(released);
+    });
+
+    it("allocates temporary handles from the arena", {
+        size_t mark = lval_arena_mark();
+        struct lval* a = lval_alloc_tmp();
+        struct lval* b = lval_alloc_tmp();
+        assert(lval_mut_num(a, 1));
+        assert(lval_mut_str(b, "b"));
+        assert(lval_arena_mark() == mark + 2);
+        /* a is given back with b. */
+        assert(lval_free(a));
+        assert(lval_arena_mark() == mark + 2);
+        assert(lval_free(b));
+        assert(lval_arena_mark() == mark);
+        /* The remaining handles are released together. */
+        struct lval* c = lval_alloc_tmp();
+        struct lval* list = lval_alloc();
+        defer(lval_free(list));
+        assert(lval_mut_qexpr(c));
+        assert(lval_dup(list, c));
+        lval_arena_release(mark);
+        assert(lval_arena_mark() == mark);
+        assert(lval_type(list) == LVAL_QEXPR);
+    });
+
+    it("keeps handles and data packed", {
+        size_t handle = 0, data = 0;
+        lval_alloc_sizes(&handle, &data);
+        /* 32 and 88 bytes before the ast side table and the packed header. */
+        if (sizeof(void*) == 8) {
+            assert(handle == 24);
+            assert(data == 40);
+        }
+    });
+
+    it("moves values into lists", {
+        struct lval* list = lval_alloc();
+        defer(lval_free(list));
+        assert(lval_mut_qexpr(list));
+        size_t handles = 0, data = 0;
+        lval_alloc_count(&handles, &data);
+        /* A handle of the heap becomes the cell. */
+        struct lval* a = lval_alloc();
+        assert(lval_mut_str(a, "a long enough string"));
+        assert(lval_push_move(list, a));
+        /* A temporary handle is given back to the arena. */
+        size_t mark = lval_arena_mark();
+        struct lval* b = lval_alloc_tmp();
+        assert(lval_mut_num(b, 2));
+        assert(lval_cons_move(list, b));
+        assert(lval_arena_mark() == mark);
+        size_t moved_handles = 0, moved_data = 0;
+        lval_alloc_count(&moved_handles, &moved_data);
+        assert(moved_handles - handles == 2);
+        assert(moved_data - data == 1);
+        char str[256];
+        to_string(list, str);
+        assert(strcmp(str, "{2 \"a long enough string\"}") == 0);
+        /* Move out of a list and into a handle. */
+        struct lval* x = lval_alloc();
+        defer(lval_free(x));
+        struct lval* y = lval_pop(list, 1);
+        assert(lval_move(x, y));
+        assert(lval_type(y) == LVAL_NIL);
+        assert(lval_free(y));
+        assert(strcmp(lval_as_str(x), "a long enough string") == 0);
+        assert(!lval_move(x, x));
+        assert(!lval_push_move(list, list));
+    });
+
+    it("shares frozen constants", {
+        struct lval* a = lval_alloc();
+        defer(lval_free(a));
+        struct lval* b = lval_alloc();
+        defer(lval_free(b));
+        assert(lval_mut_str(a, "constant"));
+        assert(lval_mut_str(b, "constant"));
+        assert(lval_freeze(a) && lval_freeze(b));
+        assert(lval_is_frozen(a) && lval_is_frozen(b));
+        assert(a->data == b->data);
+        struct lval* list = lval_alloc();
+        defer(lval_free(list));
+        assert(lval_mut_qexpr(list));
+        assert(lval_push(list, a));
+        assert(lval_freeze(list));
+        /* A copy of a constant is written, not the constant. */
+        struct lval* x = lval_alloc();
+        defer(lval_free(x));
+        assert(lval_dup(x, list));
+        assert(lval_is_frozen(x));
+        assert(lval_push(x, b));
+        assert(!lval_is_frozen(x));
+        assert(lval_len(list) == 1 && lval_len(x) == 2);
+        assert(lval_dup(x, a));
+        assert(lval_mut_str(x, "mutated"));
+        assert(strcmp(lval_as_str(b), "constant") == 0);
+    });
+
+    it("collects a list containing itself", {
+        lval_set_gc_mode(LGC_TRACE);
+        defer(lval_set_gc_mode(LGC_REFC));
+        struct lval* kept = lval_alloc();
+        assert(lval_mut_qexpr(kept));
+        assert(lval_push(kept, kept));
+        struct lval* v = lval_alloc();
+        assert(lval_mut_qexpr(v));
+        assert(lval_push(v, v));
+        assert(lval_push(v, kept));
+        assert(lval_free(v));
+        /* Only v is unreachable, kept is still held. */
+        assert(lval_gc_collect() == 1);
+        assert(lval_len(kept) == 1);
+        assert(lval_gc_collect() == 0);
+        assert(lval_free(kept));
+        assert(lval_gc_collect() == 1);
+    });
+
     subdesc(mut, {
         it("mutates a lval to a num", {
             long input = 10;
@@ -49,6 +194,51 @@ describe(lval, {
             mpz_clear(input);
         });
 
+        it("demotes a bignum which fits in a long", {
+            mpz_t input;
+            mpz_init_set_si(input, LONG_MIN);
+            struct lval* v = lval_alloc();
+            defer(lval_free(v));
+            assert(lval_mut_bignum(v, input));
+            long got = 0;
+            assert(lval_type(v) == LVAL_NUM);
+            assert(lval_as_num(v, &got) && got == LONG_MIN);
+            mpz_sub_ui(input, input, 1);
+            assert(lval_mut_bignum(v, input));
+            assert(lval_type(v) == LVAL_BIGNUM);
+            mpz_clear(input);
+        });
+
+        it("updates a bignum held alone in place", {
+            mpz_t input;
+            mpz_init_set_ui(input, ULONG_MAX);
+            struct lval* v = lval_alloc();
+            defer(lval_free(v));
+            struct lval* x = lval_alloc();
+            defer(lval_free(x));
+            assert(lval_mut_bignum(v, input));
+            assert(lval_mut_num(x, 2));
+            struct ldata* data = v->data;
+            assert(lval_mut_bignum_op(v, mpz_mul, x));
+            assert(v->data == data);
+            /* A shared bignum is copied. */
+            struct lval* w = lval_alloc();
+            defer(lval_free(w));
+            assert(lval_dup(w, v));
+            assert(lval_mut_bignum_op(v, mpz_add, x));
+            assert(v->data != data && w->data == data);
+            mpz_mul_ui(input, input, 2);
+            mpz_add_ui(input, input, 2);
+            mpz_t got;
+            mpz_init(got);
+            assert(lval_as_bignum(v, got) && mpz_cmp(got, input) == 0);
+            mpz_clear(got);
+            /* The result is demoted. */
+            assert(lval_mut_bignum_op(w, mpz_sub, w));
+            assert(lval_type(w) == LVAL_NUM);
+            mpz_clear(input);
+        });
+
         it("mutates a lval to a double", {
             double input = 10;
             struct lval* v = lval_alloc();
@@ -232,6 +422,29 @@ describe(lval, {
             assert(lval_as_num(dest, &got));
             assert(got == 10);
         });
+
+        it("keeps immediate values apart", {
+            struct lval* x = lval_alloc();
+            defer(lval_free(x));
+            struct lval* y = lval_alloc();
+            defer(lval_free(y));
+            size_t handles = 0, data = 0;
+            lval_alloc_count(&handles, &data);
+            assert(lval_mut_num(x, 1));
+            assert(lval_dup(y, x));
+            assert(lval_mut_num(x, 2));
+            assert(lval_mut_dbl(y, 2.5));
+            assert(lval_mut_bool(y, true));
+            assert(lval_dup(y, &lone));
+            size_t handles_end = 0, data_end = 0;
+            lval_alloc_count(&handles_end, &data_end);
+            assert(data_end == data);
+            assert(lval_mut_num(y, 3));
+            assert(!lval_are_equal(x, y));
+            assert(lval_compare(x, y) < 0);
+            long got = 0;
+            assert(lval_as_num(x, &got) && got == 2);
+        });
     });
 
     subdesc(copy, {
@@ -517,11 +730,6 @@ describe(lval, {
             struct lval* a = lval_alloc();
             struct lval* b = lval_alloc();
             assert(lval_mut_num(a, 1));
-            mpz_t ibn;
-            mpz_init_set_si(ibn, 1);
-            assert(lval_mut_bignum(b, ibn));
-            assert(!lval_are_equal(a, b));
-            mpz_clear(ibn);
             assert(lval_mut_dbl(b, 1.0));
             assert(!lval_are_equal(a, b));
             assert(lval_mut_str(b, "not equal"));
@@ -549,6 +757,24 @@ describe(lval, {
             assert(0 < lval_compare(a, b));
         });
 
+        it("passes for LVAL_NUM & LVAL_BIGNUM", {
+            struct lval* a = lval_alloc();
+            struct lval* b = lval_alloc();
+            defer(lval_free(a));
+            defer(lval_free(b));
+            mpz_t big;
+            mpz_init_set_ui(big, ULONG_MAX);
+            assert(lval_mut_num(a, LONG_MAX));
+            assert(lval_mut_bignum(b, big));
+            assert(0 > lval_compare(a, b));
+            assert(0 < lval_compare(b, a));
+            mpz_neg(big, big);
+            assert(lval_mut_bignum(b, big));
+            assert(0 < lval_compare(a, b));
+            assert(0 > lval_compare(b, a));
+            mpz_clear(big);
+        });
+
         it("passes for LVAL_STR", {
             struct lval* a = lval_alloc();
             struct lval* b = lval_alloc();
@@ -807,6 +1033,53 @@ describe(lval, {
             assert(lval_push(qexpr, b));
             assert(lval_len(qexpr) == 3);
         });
+
+        it("lval_cons, lval_push and lval_pop work on long lists", {
+            struct lval* x = lval_alloc();
+            defer(lval_free(x));
+            struct lval* qexpr = lval_alloc();
+            defer(lval_free(qexpr));
+            assert(lval_mut_qexpr(qexpr));
+            /* {-999 ... -1 0 1 ... 999} */
+            for (long n = 0; n < 1000; n++) {
+                lval_mut_num(x, n);
+                assert(lval_push(qexpr, x));
+                if (n > 0) {
+                    lval_mut_num(x, -n);
+                    assert(lval_cons(qexpr, x));
+                }
+            }
+            assert(lval_len(qexpr) == 1999);
+            long got = 0;
+            assert(lval_index(qexpr, 0, x));
+            assert(lval_as_num(x, &got) && got == -999);
+            assert(lval_index(qexpr, 1998, x));
+            assert(lval_as_num(x, &got) && got == 999);
+            /* Pop from both ends and from the middle. */
+            for (long n = 999; n > 0; n--) {
+                struct lval* first = lval_pop(qexpr, 0);
+                assert(lval_as_num(first, &got) && got == -n);
+                lval_free(first);
+                struct lval* last = lval_pop(qexpr, lval_len(qexpr)-1);
+                assert(lval_as_num(last, &got) && got == n);
+                lval_free(last);
+            }
+            assert(lval_len(qexpr) == 1);
+            assert(lval_index(qexpr, 0, x));
+            assert(lval_as_num(x, &got) && got == 0);
+            assert(lval_drop(qexpr, 0));
+            assert(lval_len(qexpr) == 0);
+            for (long n = 42; n < 47; n++) {
+                lval_mut_num(x, n);
+                assert(lval_push(qexpr, x));
+            }
+            struct lval* middle = lval_pop(qexpr, 1);
+            assert(lval_as_num(middle, &got) && got == 43);
+            lval_free(middle);
+            char str[256];
+            to_string(qexpr, str);
+            assert(strcmp(str, "{42 44 45 46}") == 0);
+        });
     });
 
     subdesc(str, {
@@ -869,6 +1142,32 @@ describe(lval, {
             assert(strcmp(expected_a, lval_as_str(a)) == 0);
         });
 
+        it("grows a short string into a long one", {
+            struct lval* a = lval_alloc();
+            defer(lval_free(a));
+            struct lval* b = lval_alloc();
+            defer(lval_free(b));
+            lval_mut_str(a, "0123456789");
+            lval_mut_str(b, "abcdefghij");
+            assert(lval_push(a, b));
+            assert(lval_cons(a, b));
+            assert(strcmp(lval_as_str(a), "abcdefghij0123456789abcdefghij") == 0);
+            assert(lval_copy(b, a));
+            lval_drop(a, 0);
+            assert(lval_len(b) == 30);
+            assert(strcmp(lval_as_str(b), "abcdefghij0123456789abcdefghij") == 0);
+            assert(strcmp(lval_as_str(a), "bcdefghij0123456789abcdefghij") == 0);
+        });
+
+        it("refuses a string longer than 32 bits lengths", {
+            struct lval* a = lval_alloc();
+            defer(lval_free(a));
+            lval_mut_str(a, "0123456789");
+            assert(!lval_alloc_range(a, (size_t)UINT32_MAX + 1));
+            assert(lval_len(a) == 10);
+            assert(strcmp(lval_as_str(a), "0123456789") == 0);
+        });
+
         it("lval_drop works for the last element", {
             const char* input = "i";
             struct lval* a = lval_alloc();
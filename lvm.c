@@ -0,0 +1,897 @@
+#include "lvm.h"
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lval.h"
+#include "lenv.h"
+#include "lerr.h"
+#include "lfunc.h"
+#include "lbuiltin.h"
+#include "lparser.h"
+#include "leval.h"
+
+/* The compiler follows leval step by step: each S-Expression pushes the
+ * values of its children on the stack of the machine, then a single
+ * instruction does what leval_sexpr does with them (set the dot variable,
+ * call the function in first position). The tree is walked once at compile
+ * time instead of once per evaluation.
+ *
+ * Scoping is dynamic (the environment of a function call is chained to the
+ * environment of the caller), so the binding of a symbol is only known at
+ * run time: symbols are interned and looked up through lenv. The formals of
+ * a lisp function are the exception: in its body, they are always bound in
+ * the frame of the call, they are read from its slots (see lfunc_resolve).
+ * The function called by an S-Expression is looked up through an inline
+ * cache of the instruction: it is usually bound globally (see lenv_cache).
+ *
+ * `if` and `loop` get their Q-Expressions compiled inline when they are
+ * literals. At run time, the inline code is only taken when the symbol is
+ * still bound to the builtin and its guards would pass, otherwise the
+ * generic call is done. Errors are relocated like lfunc_exec would do.
+ * Likewise, the arithmetic and comparison operators are executed inline on
+ * the numbers on top of the stack, other values are left to the builtin.
+ *
+ * A call in tail position of a lisp function body (possibly through the
+ * branches of an inline `if`) reuses the run of the caller: the callee
+ * environment takes the place of the caller one (see lenv_inherit) and the
+ * callee code is executed without growing the C stack. */
+
+/** lopcode is an instruction of the virtual machine.
+ ** The stack effect of each instruction is given in comments. */
+enum lopcode {
+    LOP_NIL,       /* -- nil */
+    LOP_CONST,     /* -- consts[a] */
+    LOP_ERROR,     /* -- consts[a], fails; b: set the error location */
+    LOP_LOOKUP,    /* -- value of consts[a]; b: set the error location; c: dot */
+    LOP_GLOBAL,    /* -- value of consts[a] through caches[c]; b: set the error location */
+    LOP_LOCAL,     /* -- value of the slot b of the frame, consts[a] is its symbol */
+    LOP_CALL,      /* a values -- result: S-Expression evaluated as an expression;
+                      b: tail call */
+    LOP_LAST,      /* a values -- last value: S-Expression not evaluated */
+    LOP_OPERATE,   /* a values -- result: LOP_CALL of the operator c (see lvm_operators) */
+    LOP_IF,        /* if cond -- ; then, else at b, generic call up to c */
+    LOP_ENDIF,     /* result -- result */
+    LOP_LOOP,      /* loop -- acc; generic call up to c */
+    LOP_LOOPTEST,  /* cond -- ; exit to a if false */
+    LOP_LOOPNEXT,  /* acc result -- result; jump to a */
+    LOP_ENDLOOP,   /* acc -- acc */
+    LOP_JUMP,      /* -- ; jump to a */
+    LOP_RET,       /* result -- */
+};
+
+/** lvm_operator is an operator executed inline by LOP_OPERATE. */
+enum lvm_operator {
+    LVM_ADD,
+    LVM_SUB,
+    LVM_MUL,
+    LVM_DIV,
+    LVM_EQ,
+    LVM_NEQ,
+    LVM_GT,
+    LVM_GTE,
+    LVM_LT,
+    LVM_LTE,
+};
+
+/** lvm_operators are the builtins of the operators, by lvm_operator. */
+static const struct lfunc* const lvm_operators[] = {
+    [LVM_ADD] = &lbuiltin_op_add,
+    [LVM_SUB] = &lbuiltin_op_sub,
+    [LVM_MUL] = &lbuiltin_op_mul,
+    [LVM_DIV] = &lbuiltin_op_div,
+    [LVM_EQ]  = &lbuiltin_op_eq,
+    [LVM_NEQ] = &lbuiltin_op_neq,
+    [LVM_GT]  = &lbuiltin_op_gt,
+    [LVM_GTE] = &lbuiltin_op_gte,
+    [LVM_LT]  = &lbuiltin_op_lt,
+    [LVM_LTE] = &lbuiltin_op_lte,
+};
+
+/** lins is an instruction with its operands. */
+struct lins {
+    enum lopcode op;
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+};
+
+struct lcode {
+    /** lcode.refc is the number of owners of the code. */
+    size_t refc;
+    /** lcode.ins are the instructions. */
+    struct lins* ins;
+    size_t insc;
+    size_t inscap;
+    /** lcode.consts are the literals and symbols used by the instructions.
+     ** They keep the ast of the source for error handling. */
+    struct lval** consts;
+    size_t constc;
+    size_t constcap;
+    /** lcode.caches are the inline caches of the LOP_GLOBAL instructions.
+     ** They are the only part of the code mutated by its execution. */
+    struct lenv_cache* caches;
+    size_t cachec;
+    size_t cachecap;
+    /** lcode.locals are the symbols of the slots of the frame in which
+     ** the code is executed, only used during compilation. */
+    const char* const* locals;
+    size_t localc;
+};
+
+/* Compiler. */
+
+/** lcode_emit appends an instruction to code and returns its position. */
+static uint32_t lcode_emit(struct lcode* code,
+        enum lopcode op, uint32_t a, uint32_t b, uint32_t c) {
+    if (code->insc == code->inscap) {
+        code->inscap = (code->inscap) ? 2 * code->inscap : 16;
+        code->ins = realloc(code->ins, code->inscap * sizeof(struct lins));
+    }
+    struct lins* ins = &code->ins[code->insc];
+    ins->op = op;
+    ins->a = a;
+    ins->b = b;
+    ins->c = c;
+    return code->insc++;
+}
+
+/** lcode_const adds v to the constants of code and returns its index. */
+static uint32_t lcode_const(struct lcode* code, const struct lval* v) {
+    if (code->constc == code->constcap) {
+        code->constcap = (code->constcap) ? 2 * code->constcap : 8;
+        code->consts = realloc(code->consts, code->constcap * sizeof(struct lval*));
+    }
+    struct lval* k = lval_alloc();
+    lval_dup(k, v);
+    code->consts[code->constc] = k;
+    return code->constc++;
+}
+
+/** lcode_cache adds an empty inline cache to code and returns its index. */
+static uint32_t lcode_cache(struct lcode* code) {
+    if (code->cachec == code->cachecap) {
+        code->cachecap = (code->cachecap) ? 2 * code->cachecap : 8;
+        code->caches = realloc(code->caches, code->cachecap * sizeof(struct lenv_cache));
+    }
+    memset(&code->caches[code->cachec], 0, sizeof(struct lenv_cache));
+    return code->cachec++;
+}
+
+/** lcode_here returns the position of the next instruction. */
+static inline uint32_t lcode_here(const struct lcode* code) {
+    return code->insc;
+}
+
+static void lcode_compile_sexpr(struct lcode* code, const struct lval* v, bool exec);
+
+/** lcode_compile_lval compiles v as leval_lval would evaluate it.
+ ** located tells if errors get the location of v (child of an S-Expression).
+ ** callee tells if v is the first child of an S-Expression. */
+static void lcode_compile_lval(struct lcode* code, const struct lval* v,
+        bool located, bool callee) {
+    switch (lval_type(v)) {
+    case LVAL_SYM:
+        {
+        const char* sym = lval_as_sym(v);
+        /* The last slot wins when a symbol is bound twice (see lenv). */
+        for (size_t s = code->localc; s-- > 0;) {
+            if (code->locals[s] == sym) {
+                lcode_emit(code, LOP_LOCAL, lcode_const(code, v), s, 0);
+                return;
+            }
+        }
+        bool dot = strcmp(sym, ".") == 0;
+        if (callee && !dot) {
+            lcode_emit(code, LOP_GLOBAL, lcode_const(code, v), located,
+                    lcode_cache(code));
+            break;
+        }
+        lcode_emit(code, LOP_LOOKUP, lcode_const(code, v), located, dot);
+        break;
+        }
+    case LVAL_SEXPR:
+        lcode_compile_sexpr(code, v, true);
+        break;
+    case LVAL_ERR:
+        lcode_emit(code, LOP_ERROR, lcode_const(code, v), located, 0);
+        break;
+    default:
+        lcode_emit(code, LOP_CONST, lcode_const(code, v), 0, 0);
+        break;
+    }
+}
+
+/** lcode_is_call tells if v is a call of symbol with len children whose
+ ** children from first are Q-Expressions. */
+static bool lcode_is_call(const struct lval* v,
+        const char* symbol, size_t len, size_t first) {
+    if (lval_len(v) != len) {
+        return false;
+    }
+    const struct lval* child = lval_index_ptr(v, 0);
+    bool is = lval_type(child) == LVAL_SYM && strcmp(lval_as_sym(child), symbol) == 0;
+    for (size_t c = first; is && c < len; c++) {
+        is = lval_type(lval_index_ptr(v, c)) == LVAL_QEXPR;
+    }
+    return is;
+}
+
+/** lcode_operator tells if v is a call of an operator executed inline and
+ ** puts it into op. The operator must not be shadowed by a slot. */
+static bool lcode_operator(const struct lcode* code, const struct lval* v,
+        enum lvm_operator* op) {
+    const struct lval* child = lval_index_ptr(v, 0);
+    if (lval_len(v) < 2 || lval_type(child) != LVAL_SYM) {
+        return false;
+    }
+    const char* sym = lval_as_sym(child);
+    for (size_t s = 0; s < code->localc; s++) {
+        if (code->locals[s] == sym) {
+            return false;
+        }
+    }
+    for (size_t o = 0; o < sizeof(lvm_operators)/sizeof(lvm_operators[0]); o++) {
+        if (strcmp(sym, lvm_operators[o]->symbol) == 0) {
+            *op = o;
+            return true;
+        }
+    }
+    return false;
+}
+
+/** lcode_compile_if compiles (if cond {then} {else}). */
+static void lcode_compile_if(struct lcode* code, const struct lval* v) {
+    struct lval* child = lval_alloc();
+    for (size_t c = 0; c < 2; c++) {
+        lval_index(v, c, child);
+        lcode_compile_lval(code, child, true, c == 0);
+    }
+    lval_index(v, 2, child);
+    uint32_t k = lcode_const(code, child);
+    lval_index(v, 3, child);
+    lcode_const(code, child);
+    uint32_t op_if = lcode_emit(code, LOP_IF, k, 0, 0);
+    /* Then. */
+    lcode_compile_sexpr(code, code->consts[k], true);
+    uint32_t op_jump = lcode_emit(code, LOP_JUMP, 0, 0, 0);
+    /* Else. */
+    code->ins[op_if].b = lcode_here(code);
+    lcode_compile_sexpr(code, code->consts[k+1], true);
+    uint32_t op_endif = lcode_emit(code, LOP_ENDIF, 0, 0, 0);
+    code->ins[op_jump].a = op_endif;
+    code->ins[op_if].c = lcode_here(code);
+    lval_free(child);
+}
+
+/** lcode_compile_loop compiles (loop {cond} {body}). */
+static void lcode_compile_loop(struct lcode* code, const struct lval* v) {
+    struct lval* child = lval_alloc();
+    lval_index(v, 0, child);
+    lcode_compile_lval(code, child, true, true);
+    lval_index(v, 1, child);
+    uint32_t k = lcode_const(code, child);
+    lval_index(v, 2, child);
+    lcode_const(code, child);
+    uint32_t op_loop = lcode_emit(code, LOP_LOOP, k, 0, 0);
+    /* Condition. */
+    uint32_t top = lcode_here(code);
+    lcode_compile_sexpr(code, code->consts[k], true);
+    uint32_t op_test = lcode_emit(code, LOP_LOOPTEST, 0, 0, 0);
+    /* Body. */
+    lcode_compile_sexpr(code, code->consts[k+1], true);
+    lcode_emit(code, LOP_LOOPNEXT, top, 0, 0);
+    code->ins[op_test].a = lcode_emit(code, LOP_ENDLOOP, 0, 0, 0);
+    code->ins[op_loop].c = lcode_here(code);
+    lval_free(child);
+}
+
+/** lcode_compile_sexpr compiles v as leval_sexpr would evaluate it.
+ ** v may also be a Q-Expression evaluated as an S-Expression. */
+static void lcode_compile_sexpr(struct lcode* code, const struct lval* v, bool exec) {
+    size_t len = lval_len(v);
+    if (len == 0) {
+        lcode_emit(code, LOP_NIL, 0, 0, 0);
+        return;
+    }
+    if (exec && lcode_is_call(v, "if", 4, 2)) {
+        lcode_compile_if(code, v);
+        return;
+    }
+    if (exec && lcode_is_call(v, "loop", 3, 1)) {
+        lcode_compile_loop(code, v);
+        return;
+    }
+    struct lval* child = lval_alloc();
+    for (size_t c = 0; c < len; c++) {
+        lval_index(v, c, child);
+        lcode_compile_lval(code, child, true, exec && c == 0);
+    }
+    lval_free(child);
+    enum lvm_operator op = 0;
+    if (exec && lcode_operator(code, v, &op)) {
+        lcode_emit(code, LOP_OPERATE, len, 0, op);
+        return;
+    }
+    lcode_emit(code, (exec) ? LOP_CALL : LOP_LAST, len, 0, 0);
+}
+
+/** lcode_mark_tail_calls marks calls whose result is returned by code. */
+static void lcode_mark_tail_calls(struct lcode* code) {
+    for (size_t pc = 0; pc < code->insc; pc++) {
+        if (code->ins[pc].op != LOP_CALL && code->ins[pc].op != LOP_OPERATE) {
+            continue;
+        }
+        size_t next = pc+1;
+        while (true) {
+            if (code->ins[next].op == LOP_JUMP) {
+                next = code->ins[next].a;
+            } else if (code->ins[next].op == LOP_ENDIF) {
+                next++;
+            } else {
+                break;
+            }
+        }
+        code->ins[pc].b = code->ins[next].op == LOP_RET;
+    }
+}
+
+/** lcode_compile_in compiles v to be executed in a frame whose slots
+ ** bind the localc symbols locals. */
+static struct lcode* lcode_compile_in(const struct lval* v, bool exec,
+        const char* const* locals, size_t localc) {
+    struct lcode* code = calloc(1, sizeof(struct lcode));
+    code->refc = 1;
+    code->locals = locals;
+    code->localc = localc;
+    if (lval_type(v) == LVAL_SEXPR) {
+        lcode_compile_sexpr(code, v, exec);
+    } else {
+        lcode_compile_lval(code, v, false, false);
+    }
+    lcode_emit(code, LOP_RET, 0, 0, 0);
+    lcode_mark_tail_calls(code);
+    code->locals = NULL;
+    code->localc = 0;
+    return code;
+}
+
+struct lcode* lcode_compile(const struct lval* v, bool exec) {
+    return lcode_compile_in(v, exec, NULL, 0);
+}
+
+/** lcode_loops tells if the S-Expression v, evaluated like an expression
+ ** when exec is set, has an inline `loop` (see lcode_compile_sexpr). */
+static bool lcode_loops(const struct lval* v, bool exec) {
+    size_t len = lval_len(v);
+    const char* head = (exec && len > 0) ? lval_as_sym(lval_index_ptr(v, 0)) : NULL;
+    if (head && strcmp(head, "loop") == 0 && lcode_is_call(v, "loop", 3, 1)) {
+        return true;
+    }
+    bool inline_if = head && strcmp(head, "if") == 0 && lcode_is_call(v, "if", 4, 2);
+    for (size_t c = 0; c < len; c++) {
+        const struct lval* child = lval_index_ptr(v, c);
+        if ((lval_type(child) == LVAL_SEXPR || (inline_if && c >= 2))
+                && lcode_loops(child, true)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool lcode_pays_off(const struct lval* v, bool exec) {
+    return v && lval_type(v) == LVAL_SEXPR && lcode_loops(v, exec);
+}
+
+struct lcode* lcode_retain(struct lcode* code) {
+    if (code) {
+        code->refc++;
+    }
+    return code;
+}
+
+void lcode_free(struct lcode* code) {
+    if (!code || --code->refc > 0) {
+        return;
+    }
+    for (size_t k = 0; k < code->constc; k++) {
+        lval_free(code->consts[k]);
+    }
+    free(code->consts);
+    free(code->caches);
+    free(code->ins);
+    free(code);
+}
+
+/* Virtual machine. */
+
+/** lvm is the state of the virtual machine, shared by nested runs
+ ** (a lisp function called from a running code is executed on top of it)
+ ** and kept between runs (see lvm_release). */
+static struct {
+    /** lvm.stack are the value handles, those above lvm.sp are nil. */
+    struct lval** stack;
+    size_t sp;
+    size_t cap;
+    /** lvm.ctx are the ast of inline `if` and `loop` being executed.
+     ** An error raised inside is relocated to it. */
+    const struct last** ctx;
+    size_t ctxc;
+    size_t ctxcap;
+    /** lvm.nil is a nil handle, used to release stack handles. */
+    struct lval* nil;
+} lvm;
+
+/** lvm_push returns a new nil handle on top of the stack. */
+static struct lval* lvm_push(void) {
+    if (lvm.sp == lvm.cap) {
+        size_t cap = (lvm.cap) ? 2 * lvm.cap : 64;
+        if (!lvm.nil) {
+            lvm.nil = lval_alloc();
+        }
+        lvm.stack = realloc(lvm.stack, cap * sizeof(struct lval*));
+        for (size_t s = lvm.cap; s < cap; s++) {
+            lvm.stack[s] = lval_alloc();
+        }
+        lvm.cap = cap;
+    }
+    return lvm.stack[lvm.sp++];
+}
+
+/** lvm_top returns the handle n places under the top of the stack. */
+static inline struct lval* lvm_top(size_t n) {
+    return lvm.stack[lvm.sp-1 - n];
+}
+
+/** lvm_pop_to releases the handles of the stack down to sp. */
+static void lvm_pop_to(size_t sp) {
+    while (lvm.sp > sp) {
+        lval_dup(lvm.stack[--lvm.sp], lvm.nil);
+    }
+}
+
+/** lvm_swap swaps two handles of the stack. */
+static inline void lvm_swap(size_t i, size_t j) {
+    struct lval* tmp = lvm.stack[i];
+    lvm.stack[i] = lvm.stack[j];
+    lvm.stack[j] = tmp;
+}
+
+/** lvm_ctx_push enters an inline `if` or `loop`. */
+static void lvm_ctx_push(const struct last* ast) {
+    if (lvm.ctxc == lvm.ctxcap) {
+        lvm.ctxcap = (lvm.ctxcap) ? 2 * lvm.ctxcap : 16;
+        lvm.ctx = realloc(lvm.ctx, lvm.ctxcap * sizeof(struct last*));
+    }
+    lvm.ctx[lvm.ctxc++] = ast;
+}
+
+/** lvm_locate sets the location of the error r to its ast. */
+static void lvm_locate(struct lval* r) {
+    struct lerr* cause = lerr_cause(lval_as_err(r));
+    const struct last* ast = lval_ast(r);
+    if (ast) {
+        lerr_set_location(cause, ast->line, ast->col);
+    }
+}
+
+/** lvm_body returns the code of the body of the lisp function fun.
+ ** It is compiled on first call then cached into fun. */
+static struct lcode* lvm_body(const struct lfunc* fun) {
+    if (!fun->code) {
+        /* Caching the compiled body does not alter fun. */
+        ((struct lfunc*)fun)->code =
+            lcode_compile_in(fun->body, true, fun->locals, fun->localc);
+    }
+    return fun->code;
+}
+
+/** lvm_tail is a call in tail position whose body is left to the caller. */
+struct lvm_tail {
+    /** lvm_tail.local is the environment of the body. */
+    struct lenv* local;
+    /** lvm_tail.code is the body (retained). */
+    struct lcode* code;
+    /** lvm_tail.ast is where an error of the body is relocated. */
+    const struct last* ast;
+};
+
+/** lvm_call evaluates the n values on top of the stack as an expression.
+ ** They are replaced by the result.
+ ** If tail is not NULL, the body of a lisp function is not executed but
+ ** described into tail, the n values are then just popped. */
+static bool lvm_call(struct lenv* env, size_t n, struct lvm_tail* tail) {
+    size_t first = lvm.sp - n;
+    leval_set_dot(lvm_top(0));
+    struct lval* func = lvm.stack[first];
+    /* Not a function: result is the last value. */
+    if (lval_type(func) != LVAL_FUNC) {
+        lvm_swap(first, lvm.sp-1);
+        lvm_pop_to(first+1);
+        return true;
+    }
+    struct lval* r = lvm_push();
+    /* Arguments are passed straight from the stack. The stack may be
+     * reallocated by the call, so argv is read before it only. */
+    size_t argc = n-1;
+    const struct lval* const* argv = (const struct lval* const*) &lvm.stack[first+1];
+    /* Execute expression. */
+    const struct lfunc* fun = lval_as_func(func);
+    int err = 0;
+    if (tail && fun->lisp_func) {
+        err = lfunc_enter(fun, env, argc, argv, r, &tail->local);
+    } else {
+        err = lfunc_apply(fun, env, argc, argv, r);
+    }
+    /* Tail call: a failure of the body is relocated to the first argument. */
+    if (tail && tail->local) {
+        tail->code = lcode_retain(lvm_body(fun));
+        tail->ast = (argc > 0) ? lval_ast(lvm.stack[first+1]) : NULL;
+        lvm_pop_to(first);
+        return true;
+    }
+    /* Error handling. */
+    if (err != 0) {
+        if (err == -1) {
+            r->ast = func->ast;
+        } else {
+            /* Set r->ast to the node returning an error. */
+            r->ast = ((size_t)err-1 < argc) ? lvm.stack[first+err]->ast : 0;
+        }
+        lvm_locate(r);
+    }
+    leval_set_dot(r);
+    lvm_swap(first, lvm.sp-1);
+    lvm_pop_to(first+1);
+    lval_gc_safe_point();
+    return lval_type(lvm_top(0)) != LVAL_ERR;
+}
+
+/** lvm_is_builtin tells if v is the builtin fun without bound arguments. */
+static bool lvm_is_builtin(const struct lval* v, const struct lfunc* fun) {
+    if (lval_type(v) != LVAL_FUNC) {
+        return false;
+    }
+    const struct lfunc* f = lval_as_func(v);
+    return f->func == fun->func && !f->lisp_func && lval_len(f->args) == 0;
+}
+
+/** lvm_operate executes the operator op on the argc values of argv into r.
+ ** It returns false, r being untouched, unless they are all numbers whose
+ ** result is a number too: other types, overflows and divisions by zero are
+ ** left to the builtin. */
+static bool lvm_operate(enum lvm_operator op,
+        size_t argc, struct lval* const* argv, struct lval* r) {
+    long x = 0;
+    long y = 0;
+    if (!lval_as_num(argv[0], &x)) {
+        return false;
+    }
+    if (op >= LVM_EQ) {
+        if (argc != 2 || !lval_as_num(argv[1], &y)) {
+            return false;
+        }
+        bool b = false;
+        switch (op) {
+        case LVM_EQ:  b = x == y; break;
+        case LVM_NEQ: b = x != y; break;
+        case LVM_GT:  b = x > y;  break;
+        case LVM_GTE: b = x >= y; break;
+        case LVM_LT:  b = x < y;  break;
+        default:      b = x <= y; break;
+        }
+        lval_mut_bool(r, b);
+        return true;
+    }
+    /* Unary operations apply to the neutral element. */
+    if (argc == 1) {
+        if (op == LVM_DIV || (op == LVM_SUB && __builtin_sub_overflow(0, x, &x))) {
+            return false;
+        }
+        lval_mut_num(r, x);
+        return true;
+    }
+    for (size_t a = 1; a < argc; a++) {
+        if (!lval_as_num(argv[a], &y)) {
+            return false;
+        }
+        bool overflow = false;
+        switch (op) {
+        case LVM_ADD: overflow = __builtin_add_overflow(x, y, &x); break;
+        case LVM_SUB: overflow = __builtin_sub_overflow(x, y, &x); break;
+        case LVM_MUL: overflow = __builtin_mul_overflow(x, y, &x); break;
+        default:
+            overflow = y == 0 || (x == LONG_MIN && y == -1);
+            x = (overflow) ? x : x / y;
+            break;
+        }
+        if (overflow) {
+            return false;
+        }
+    }
+    lval_mut_num(r, x);
+    return true;
+}
+
+/** lvm_pending is the relocation of the errors of the calls eliminated by
+ ** tail calls. Relocating an error several times only keeps the last ast and
+ ** the last location, so they are collapsed into this one. */
+struct lvm_pending {
+    bool set;
+    /** lvm_pending.last is the ast of the last relocation. */
+    const struct last* last;
+    /** lvm_pending.located is the ast of the last location, may be NULL. */
+    const struct last* located;
+};
+
+/** lvm_pending_push adds the relocations of the current run to pending.
+ ** They are done before the ones already pending: the error of the callee
+ ** is first relocated to ast, then to the contexts of the current run. */
+static void lvm_pending_push(struct lvm_pending* pending,
+        const struct last* ast, size_t ctx_base) {
+    const struct last* last = ast;
+    const struct last* located = ast;
+    if (lvm.ctxc > ctx_base) {
+        last = lvm.ctx[ctx_base];
+    }
+    for (size_t c = ctx_base; c < lvm.ctxc; c++) {
+        if (lvm.ctx[c]) {
+            located = lvm.ctx[c];
+            break;
+        }
+    }
+    if (!pending->set) {
+        pending->set = true;
+        pending->last = last;
+        pending->located = located;
+    } else if (!pending->located) {
+        pending->located = located;
+    }
+}
+
+/** lvm_exec executes code in env and puts the result into r.
+ ** frame tells if code is the body of a lisp function executed in env:
+ ** its calls in tail position are then eliminated. */
+static bool lvm_exec(const struct lcode* code, struct lenv* env,
+        struct lval* r, bool frame) {
+    size_t base = lvm.sp;
+    size_t ctx_base = lvm.ctxc;
+    bool s = true;
+    const struct lins* ins = code->ins;
+    struct lval* const* k = (struct lval* const*) code->consts;
+    struct lenv_cache* caches = code->caches;
+    /* The root is kept by tail calls (see lenv_inherit). */
+    const struct lenv* root = lenv_root(env);
+    size_t pc = 0;
+    /* Code and environment of the function called in tail position. */
+    struct lcode* owned_code = NULL;
+    struct lenv* owned_env = NULL;
+    struct lvm_pending pending = {0};
+    while (true) {
+        const struct lins* in = &ins[pc++];
+        switch (in->op) {
+        case LOP_NIL:
+            lvm_push();
+            break;
+        case LOP_CONST:
+            lval_dup(lvm_push(), k[in->a]);
+            break;
+        case LOP_ERROR:
+            {
+            struct lval* x = lvm_push();
+            lval_dup(x, k[in->a]);
+            if (in->b) {
+                lvm_locate(x);
+            }
+            goto fail;
+            }
+        case LOP_LOOKUP:
+        case LOP_GLOBAL:
+            {
+            struct lval* x = NULL;
+            bool found = false;
+            if (in->op == LOP_GLOBAL) {
+                x = lvm_push();
+                found = lenv_lookup_cached(env, root, k[in->a], &caches[in->c], x);
+            } else {
+                if (in->c) {
+                    leval_flush_dot(env);
+                }
+                x = lvm_push();
+                found = lenv_lookup(env, k[in->a], x);
+            }
+            x->ast = k[in->a]->ast;
+            if (!found) {
+                if (in->b) {
+                    lvm_locate(x);
+                }
+                goto fail;
+            }
+            break;
+            }
+        case LOP_LOCAL:
+            {
+            struct lval* x = lvm_push();
+            lval_dup(x, lenv_slot(env, in->b));
+            x->ast = k[in->a]->ast;
+            break;
+            }
+        case LOP_OPERATE:
+            {
+            /* The result replaces the operator, like lvm_call does. */
+            size_t first = lvm.sp - in->a;
+            struct lval* op = lvm.stack[first];
+            if (lvm_is_builtin(op, lvm_operators[in->c])
+                    && lvm_operate(in->c, in->a-1, &lvm.stack[first+1], op)) {
+                leval_set_dot(op);
+                lvm_pop_to(first+1);
+                break;
+            }
+            }
+            // fallthrough
+        case LOP_CALL:
+            {
+            struct lvm_tail tail = {0};
+            bool is_tail = in->b && frame;
+            if (!lvm_call(env, in->a, is_tail ? &tail : NULL)) {
+                goto fail;
+            }
+            if (!tail.local) {
+                break;
+            }
+            /* The callee replaces the current run. */
+            lvm_pending_push(&pending, tail.ast, ctx_base);
+            lvm.ctxc = ctx_base;
+            lvm_pop_to(base);
+            lenv_inherit(tail.local, env);
+            if (owned_env) {
+                lenv_free(owned_env);
+            }
+            env = owned_env = tail.local;
+            if (owned_code) {
+                lcode_free(owned_code);
+            }
+            code = owned_code = tail.code;
+            ins = code->ins;
+            k = (struct lval* const*) code->consts;
+            caches = code->caches;
+            pc = 0;
+            break;
+            }
+        case LOP_LAST:
+            leval_set_dot(lvm_top(0));
+            lvm_swap(lvm.sp - in->a, lvm.sp-1);
+            lvm_pop_to(lvm.sp - in->a + 1);
+            break;
+        case LOP_IF:
+            {
+            const struct lval* cond = lvm_top(0);
+            if (lvm_is_builtin(lvm_top(1), &lbuiltin_if)
+                    && lval_type(cond) == LVAL_BOOL) {
+                lvm_ctx_push(lval_ast(cond));
+                leval_set_dot(k[in->a+1]);
+                if (!lval_as_bool(cond)) {
+                    pc = in->b;
+                }
+                lvm_pop_to(lvm.sp-2);
+                break;
+            }
+            lval_dup(lvm_push(), k[in->a]);
+            lval_dup(lvm_push(), k[in->a+1]);
+            if (!lvm_call(env, 4, NULL)) {
+                goto fail;
+            }
+            pc = in->c;
+            break;
+            }
+        case LOP_ENDIF:
+        case LOP_ENDLOOP:
+            lvm.ctxc--;
+            leval_set_dot(lvm_top(0));
+            break;
+        case LOP_LOOP:
+            if (lvm_is_builtin(lvm_top(0), &lbuiltin_loop)) {
+                lvm_ctx_push(lval_ast(k[in->a]));
+                leval_set_dot(k[in->a+1]);
+                lvm_pop_to(lvm.sp-1);
+                lvm_push(); // acc = nil
+                break;
+            }
+            lval_dup(lvm_push(), k[in->a]);
+            lval_dup(lvm_push(), k[in->a+1]);
+            if (!lvm_call(env, 3, NULL)) {
+                goto fail;
+            }
+            pc = in->c;
+            break;
+        case LOP_LOOPTEST:
+            {
+            bool loop = lval_as_bool(lvm_top(0));
+            lvm_pop_to(lvm.sp-1);
+            if (!loop) {
+                pc = in->a;
+            }
+            break;
+            }
+        case LOP_LOOPNEXT:
+            lvm_swap(lvm.sp-2, lvm.sp-1);
+            lvm_pop_to(lvm.sp-1);
+            pc = in->a;
+            break;
+        case LOP_JUMP:
+            pc = in->a;
+            break;
+        case LOP_RET:
+            lval_dup(r, lvm_top(0));
+            /* Result of the calls eliminated. */
+            if (pending.set) {
+                leval_set_dot(r);
+            }
+            goto done;
+        }
+    }
+fail:
+    s = false;
+    lval_dup(r, lvm_top(0));
+    /* Relocate the error like lfunc_exec does for `if` and `loop`. */
+    while (lvm.ctxc > ctx_base) {
+        lval_set_ast(r, lvm.ctx[--lvm.ctxc]);
+        lvm_locate(r);
+        leval_set_dot(r);
+    }
+    /* Then like the calls eliminated by tail calls would have done. */
+    if (pending.set) {
+        lval_set_ast(r, pending.located);
+        lvm_locate(r);
+        lval_set_ast(r, pending.last);
+        leval_set_dot(r);
+    }
+done:
+    lvm_pop_to(base);
+    lvm.ctxc = ctx_base;
+    if (owned_env) {
+        lenv_free(owned_env);
+    }
+    if (owned_code) {
+        lcode_free(owned_code);
+    }
+    return s;
+}
+
+bool lvm_run(const struct lcode* code, struct lenv* env, struct lval* r) {
+    bool s = lvm_exec(code, env, r, false);
+    leval_flush_dot(env);
+    return s;
+}
+
+bool lvm_eval(struct lenv* env, const struct lval* v, struct lval* r, bool exec) {
+    if (!v) {
+        struct lerr* err = lerr_throw(LERR_EVAL,
+                "the impossible happens, NULL pointer received");
+        lval_mut_err_ptr(r, err);
+        return false;
+    }
+    struct lcode* code = lcode_compile(v, exec);
+    bool s = lvm_run(code, env, r);
+    lcode_free(code);
+    return s;
+}
+
+bool lvm_exec_body(const struct lfunc* fun, struct lenv* env, struct lval* r) {
+    return lvm_exec(lvm_body(fun), env, r, true);
+}
+
+void lvm_release(void) {
+    for (size_t s = 0; s < lvm.cap; s++) {
+        lval_free(lvm.stack[s]);
+    }
+    free(lvm.stack);
+    free(lvm.ctx);
+    if (lvm.nil) {
+        lval_free(lvm.nil);
+    }
+    memset(&lvm, 0, sizeof(lvm));
+}
@@ -0,0 +1,40 @@
+#ifndef _H_LVM_
+#define _H_LVM_
+
+#include <stdbool.h>
+
+#include "lval.h"
+#include "lenv.h"
+#include "lfunc.h"
+
+/** lcode is a program compiled to the bytecode of the virtual machine.
+ ** It is immutable once compiled, except its inline caches, and may be shared
+ ** (see lcode_retain). */
+struct lcode;
+
+/** lcode_compile compiles v the way leval evaluates it.
+ ** exec tells if the S-Expression v should be evaluated like an expression.
+ ** Caller is responsible for calling lcode_free. */
+struct lcode* lcode_compile(const struct lval* v, bool exec);
+/** lcode_pays_off tells if compiling v pays off over walking it once:
+ ** only the inline `loop` execute their code more than once.
+ ** exec is the same as for lcode_compile. */
+bool lcode_pays_off(const struct lval* v, bool exec);
+/** lcode_retain shares code with one more owner. */
+struct lcode* lcode_retain(struct lcode* code);
+/** lcode_free releases code; it is freed when its last owner releases it. */
+void lcode_free(struct lcode* code);
+
+/** lvm_run executes code in env and puts the result into r.
+ ** The dot variable is bound into env when it returns.
+ ** lvm_run returns false if r is an error. */
+bool lvm_run(const struct lcode* code, struct lenv* env, struct lval* r);
+/** lvm_eval compiles v then executes it (see lcode_compile). */
+bool lvm_eval(struct lenv* env, const struct lval* v, struct lval* r, bool exec);
+/** lvm_exec_body executes the body of the lisp function fun in env.
+ ** The body is compiled on first call then cached into fun. */
+bool lvm_exec_body(const struct lfunc* fun, struct lenv* env, struct lval* r);
+/** lvm_release frees the state kept by the virtual machine between runs. */
+void lvm_release(void);
+
+#endif
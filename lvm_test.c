@@ -0,0 +1,307 @@
+#include "lvm.h"
+
+#include <limits.h>
+
+#include "vendor/snow/snow/snow.h"
+
+#include "lval.h"
+#include "lenv.h"
+
+#define push_sym(list, name) \
+    do { \
+        struct lval* x = lval_alloc(); \
+        lval_mut_sym(x, name); \
+        lval_push(list, x); \
+        lval_free(x); \
+    } while (0);
+
+#define push_num(list, num) \
+    do { \
+        struct lval* x = lval_alloc(); \
+        lval_mut_num(x, num); \
+        lval_push(list, x); \
+        lval_free(x); \
+    } while (0);
+
+describe(lvm, {
+    it("runs a literal", {
+        struct lenv* env = lenv_alloc();
+        defer(lenv_free(env));
+        struct lval* v = lval_alloc();
+        defer(lval_free(v));
+        lval_mut_num(v, 42);
+        struct lval* r = lval_alloc();
+        defer(lval_free(r));
+        struct lcode* code = lcode_compile(v, true);
+        defer(lcode_free(code));
+        assert(lvm_run(code, env, r));
+        assert(lval_are_equal(r, v));
+    });
+
+    it("runs an expression twice", {
+        struct lenv* env = lenv_alloc();
+        defer(lenv_free(env));
+        lenv_default(env);
+        struct lval* v = lval_alloc();
+        defer(lval_free(v));
+        lval_mut_sexpr(v);
+        push_sym(v, "+");
+        push_num(v, 40);
+        push_num(v, 2);
+        struct lval* r = lval_alloc();
+        defer(lval_free(r));
+        struct lcode* code = lcode_compile(v, true);
+        defer(lcode_free(code));
+        long x = 0;
+        assert(lvm_run(code, env, r));
+        assert(lval_as_num(r, &x) && x == 42);
+        assert(lvm_run(code, env, r));
+        assert(lval_as_num(r, &x) && x == 42);
+    });
+
+    it("does not evaluate a S-Expression as an expression", {
+        struct lenv* env = lenv_alloc();
+        defer(lenv_free(env));
+        lenv_default(env);
+        struct lval* v = lval_alloc();
+        defer(lval_free(v));
+        lval_mut_sexpr(v);
+        push_sym(v, "+");
+        push_num(v, 40);
+        struct lval* r = lval_alloc();
+        defer(lval_free(r));
+        assert(lvm_eval(env, v, r, false));
+        long x = 0;
+        assert(lval_as_num(r, &x) && x == 40);
+    });
+
+    it("sets the dot variable", {
+        struct lenv* env = lenv_alloc();
+        defer(lenv_free(env));
+        lenv_default(env);
+        struct lval* v = lval_alloc();
+        defer(lval_free(v));
+        lval_mut_sexpr(v);
+        push_sym(v, "*");
+        push_num(v, 21);
+        push_num(v, 2);
+        struct lval* r = lval_alloc();
+        defer(lval_free(r));
+        assert(lvm_eval(env, v, r, true));
+        struct lval* dot = lval_alloc();
+        defer(lval_free(dot));
+        lval_mut_sym(dot, ".");
+        assert(lenv_lookup(env, dot, r));
+        long x = 0;
+        assert(lval_as_num(r, &x) && x == 42);
+    });
+
+    it("fails on an undefined symbol", {
+        struct lenv* env = lenv_alloc();
+        defer(lenv_free(env));
+        struct lval* v = lval_alloc();
+        defer(lval_free(v));
+        lval_mut_sexpr(v);
+        push_sym(v, "undefined");
+        struct lval* r = lval_alloc();
+        defer(lval_free(r));
+        assert(!lvm_eval(env, v, r, true));
+        assert(lval_type(r) == LVAL_ERR);
+    });
+
+    it("looks up a redefined function again", {
+        struct lenv* env = lenv_alloc();
+        defer(lenv_free(env));
+        lenv_default(env);
+        struct lval* v = lval_alloc();
+        defer(lval_free(v));
+        lval_mut_sexpr(v);
+        push_sym(v, "f");
+        push_num(v, 40);
+        push_num(v, 2);
+        struct lval* sym = lval_alloc();
+        defer(lval_free(sym));
+        struct lval* fun = lval_alloc();
+        defer(lval_free(fun));
+        lval_mut_sym(sym, "+");
+        assert(lenv_lookup(env, sym, fun));
+        lval_mut_sym(sym, "f");
+        assert(lenv_def(env, sym, fun));
+        struct lval* r = lval_alloc();
+        defer(lval_free(r));
+        struct lcode* code = lcode_compile(v, true);
+        defer(lcode_free(code));
+        long x = 0;
+        assert(lvm_run(code, env, r));
+        assert(lval_as_num(r, &x) && x == 42);
+        lval_mut_sym(sym, "-");
+        assert(lenv_lookup(env, sym, fun));
+        lval_mut_sym(sym, "f");
+        assert(lenv_def(env, sym, fun));
+        assert(lvm_run(code, env, r));
+        assert(lval_as_num(r, &x) && x == 38);
+    });
+
+    it("runs the same code in another environment", {
+        struct lenv* plus = lenv_alloc();
+        defer(lenv_free(plus));
+        lenv_default(plus);
+        struct lenv* minus = lenv_alloc();
+        defer(lenv_free(minus));
+        lenv_default(minus);
+        struct lval* v = lval_alloc();
+        defer(lval_free(v));
+        lval_mut_sexpr(v);
+        push_sym(v, "g");
+        push_num(v, 40);
+        push_num(v, 2);
+        struct lval* sym = lval_alloc();
+        defer(lval_free(sym));
+        struct lval* fun = lval_alloc();
+        defer(lval_free(fun));
+        lval_mut_sym(sym, "+");
+        assert(lenv_lookup(plus, sym, fun));
+        lval_mut_sym(sym, "g");
+        assert(lenv_put(plus, sym, fun));
+        lval_mut_sym(sym, "-");
+        assert(lenv_lookup(minus, sym, fun));
+        lval_mut_sym(sym, "g");
+        assert(lenv_put(minus, sym, fun));
+        struct lval* r = lval_alloc();
+        defer(lval_free(r));
+        struct lcode* code = lcode_compile(v, true);
+        defer(lcode_free(code));
+        long x = 0;
+        assert(lvm_run(code, plus, r));
+        assert(lval_as_num(r, &x) && x == 42);
+        assert(lvm_run(code, minus, r));
+        assert(lval_as_num(r, &x) && x == 38);
+    });
+
+    it("looks up a function shadowed by a local environment", {
+        struct lenv* env = lenv_alloc();
+        defer(lenv_free(env));
+        lenv_default(env);
+        struct lenv* local = lenv_alloc();
+        defer(lenv_free(local));
+        lenv_set_parent(local, env);
+        struct lval* v = lval_alloc();
+        defer(lval_free(v));
+        lval_mut_sexpr(v);
+        push_sym(v, "h");
+        push_num(v, 40);
+        push_num(v, 2);
+        struct lval* sym = lval_alloc();
+        defer(lval_free(sym));
+        struct lval* fun = lval_alloc();
+        defer(lval_free(fun));
+        lval_mut_sym(sym, "+");
+        assert(lenv_lookup(env, sym, fun));
+        lval_mut_sym(sym, "h");
+        assert(lenv_put(env, sym, fun));
+        struct lval* r = lval_alloc();
+        defer(lval_free(r));
+        struct lcode* code = lcode_compile(v, true);
+        defer(lcode_free(code));
+        long x = 0;
+        assert(lvm_run(code, local, r));
+        assert(lval_as_num(r, &x) && x == 42);
+        lval_mut_sym(sym, "-");
+        assert(lenv_lookup(env, sym, fun));
+        lval_mut_sym(sym, "h");
+        assert(lenv_put(local, sym, fun));
+        assert(lvm_run(code, local, r));
+        assert(lval_as_num(r, &x) && x == 38);
+        assert(lvm_run(code, env, r));
+        assert(lval_as_num(r, &x) && x == 42);
+    });
+
+    it("executes an operator inline unless it is rebound", {
+        struct lenv* env = lenv_alloc();
+        defer(lenv_free(env));
+        lenv_default(env);
+        struct lval* v = lval_alloc();
+        defer(lval_free(v));
+        lval_mut_sexpr(v);
+        push_sym(v, "+");
+        push_num(v, 40);
+        push_num(v, 2);
+        struct lval* r = lval_alloc();
+        defer(lval_free(r));
+        struct lcode* code = lcode_compile(v, true);
+        defer(lcode_free(code));
+        long x = 0;
+        assert(lvm_run(code, env, r));
+        assert(lval_as_num(r, &x) && x == 42);
+        struct lval* sym = lval_alloc();
+        defer(lval_free(sym));
+        struct lval* fun = lval_alloc();
+        defer(lval_free(fun));
+        lval_mut_sym(sym, "-");
+        assert(lenv_lookup(env, sym, fun));
+        lval_mut_sym(sym, "+");
+        assert(lenv_def(env, sym, fun));
+        assert(lvm_run(code, env, r));
+        assert(lval_as_num(r, &x) && x == 38);
+    });
+
+    it("leaves an overflowing operation to the builtin", {
+        struct lenv* env = lenv_alloc();
+        defer(lenv_free(env));
+        lenv_default(env);
+        struct lval* v = lval_alloc();
+        defer(lval_free(v));
+        lval_mut_sexpr(v);
+        push_sym(v, "*");
+        push_num(v, LONG_MAX);
+        push_num(v, 2);
+        struct lval* r = lval_alloc();
+        defer(lval_free(r));
+        assert(lvm_eval(env, v, r, true));
+        assert(lval_type(r) == LVAL_BIGNUM);
+    });
+
+    it("shares compiled code", {
+        struct lval* v = lval_alloc();
+        defer(lval_free(v));
+        lval_mut_num(v, 1);
+        struct lcode* code = lcode_compile(v, true);
+        assert(lcode_retain(code) == code);
+        lcode_free(code);
+        lcode_free(code);
+    });
+
+    it("compiles only the programs which loop", {
+        struct lval* body = lval_alloc();
+        defer(lval_free(body));
+        lval_mut_qexpr(body);
+        push_sym(body, "x");
+        struct lval* loop = lval_alloc();
+        defer(lval_free(loop));
+        lval_mut_sexpr(loop);
+        push_sym(loop, "loop");
+        lval_push(loop, body);
+        lval_push(loop, body);
+        struct lval* v = lval_alloc();
+        defer(lval_free(v));
+        lval_mut_sexpr(v);
+        push_sym(v, "+");
+        push_num(v, 1);
+        assert(!lcode_pays_off(v, true));
+        lval_push(v, loop);
+        assert(lcode_pays_off(v, true));
+        /* A quoted loop is not compiled inline. */
+        lval_mut_qexpr(loop);
+        push_sym(loop, "loop");
+        lval_push(loop, body);
+        lval_push(loop, body);
+        struct lval* w = lval_alloc();
+        defer(lval_free(w));
+        lval_mut_sexpr(w);
+        push_sym(w, "list");
+        lval_push(w, loop);
+        assert(!lcode_pays_off(w, true));
+    });
+});
+
+snow_main();
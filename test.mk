@@ -1,8 +1,8 @@
 # Config: files & dirs.
-tests:=generic/avl_test.c generic/mempool_test.c \
-	llexer_test.c lparser_test.c lmut_test.c \
+tests:=generic/avl_test.c generic/htable_test.c generic/mempool_test.c \
+	llexer_test.c lparser_test.c lmut_test.c lsym_test.c \
 	lval_test.c lenv_test.c lbuiltin_operator_test.c lbuiltin_func_test.c \
-	leval_test.c marker_test.c
+	leval_test.c lvm_test.c marker_test.c
 test_build_dir:=$(build_dir)
 
 tests_lisp:=test/stdlib_test.lisp
@@ -31,6 +31,8 @@ $(test_build_dir)/%_test.o: %_test.c $$(@D)/.f
 
 $(tests_lisp): $(PROGNAME)
 	./$< -f $@
+	./$< -e vm -f $@
+	./$< -e vm-all -f $@
 
 clean::
 	rm -f $(testobjects_built) $(testcases_built)